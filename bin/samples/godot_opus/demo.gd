@@ -125,10 +125,8 @@ func _process_mic():
 		# Push the data onto the encode buffer
 		opus.push_buffer(stereo_data)
 
-	while opus.has_encoded_packet():
-		# If GodotOpus has encoded packets available (ie. there is enough data on the encode buffer)
-		var packet: PackedByteArray = opus.get_encoded_packet()
-
+	# Encode every packet available on the encode buffer (ie. there is enough data on the encode buffer)
+	for packet in opus.get_encoded_packets():
 		if packet.is_empty():
 			printerr("Error encoding packet")
 			break
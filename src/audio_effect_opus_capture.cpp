@@ -0,0 +1,377 @@
+
+#include <string.h>
+
+#include <godot_cpp/classes/audio_server.hpp>
+#include <godot_cpp/core/class_db.hpp>
+
+#include "audio_effect_opus_capture.h"
+#include "audio_kernels.h"
+
+using namespace godot;
+
+// AudioEffectOpusCaptureInstance ///////////////////////////////////////////
+
+AudioEffectOpusCaptureInstance::AudioEffectOpusCaptureInstance() {
+	encoder = NULL;
+	encoder_initialized = false;
+	frame_fill = 0;
+
+	sampling_rate = 48000;
+	channels = GodotOpus::CHANNELS_STEREO;
+	max_payload_bytes = 1024;
+	frame_size = GodotOpus::calculate_frame_size(sampling_rate, GodotOpus::FRAMESIZE_20_MS);
+}
+
+AudioEffectOpusCaptureInstance::~AudioEffectOpusCaptureInstance() {
+	if (encoder != NULL) {
+		opus_encoder_destroy(encoder);
+		encoder = NULL;
+	}
+}
+
+void AudioEffectOpusCaptureInstance::_process(const void *src_buffer, AudioFrame *dst_buffer, int32_t frame_count) {
+	// Pass the audio through untouched, like AudioEffectCapture
+	const AudioFrame *src = static_cast<const AudioFrame *>(src_buffer);
+	memcpy(dst_buffer, src, sizeof(AudioFrame) * frame_count);
+
+	if (encoder_initialized) {
+		_capture_frames(src, frame_count);
+	}
+}
+
+bool AudioEffectOpusCaptureInstance::_process_silence() const {
+	// Keep the stream continuous while the bus is silent
+	return true;
+}
+
+bool AudioEffectOpusCaptureInstance::_initialize_encoder(const AudioEffectOpusCapture *p_base) {
+	// Called once from _instantiate, before the audio thread can see the instance
+	channels = p_base->channels;
+	max_payload_bytes = p_base->max_payload_bytes;
+
+	// Other mix rates (e.g. 44.1 kHz) are resampled to 48 kHz before encoding
+	const int mix_rate = (int)AudioServer::get_singleton()->get_mix_rate();
+	sampling_rate = mix_rate;
+	if (sampling_rate != 8000 && sampling_rate != 12000 && sampling_rate != 16000 && sampling_rate != 24000 && sampling_rate != 48000) {
+		sampling_rate = 48000;
+	}
+	resampler.setup(mix_rate, sampling_rate, (int)channels);
+	if (resampler.is_active()) {
+		capture_pcm.resize(AudioResampler::BLOCK_FRAMES * (int)channels);
+		resampled_pcm.resize(resampler.get_max_output(AudioResampler::BLOCK_FRAMES) * (int)channels);
+	}
+
+	int err;
+	encoder = opus_encoder_create(sampling_rate, (int)channels, (int)p_base->application_mode, &err);
+	ERR_FAIL_COND_V_MSG(err != OPUS_OK, false, opus_strerror(err));
+
+	opus_encoder_ctl(encoder, OPUS_SET_COMPLEXITY(p_base->encoder_complexity));
+	opus_encoder_ctl(encoder, OPUS_SET_DTX(p_base->dtx ? 1 : 0));
+	opus_encoder_ctl(encoder, OPUS_SET_VBR(p_base->bitrate_mode == GodotOpus::BITRATE_CONSTANT ? 0 : 1));
+	if (p_base->bitrate_mode == GodotOpus::BITRATE_VARIABLE_AUTO || p_base->bitrate_mode == GodotOpus::BITRATE_VARIABLE_BITRATE_MAX) {
+		opus_encoder_ctl(encoder, OPUS_SET_BITRATE(p_base->bitrate_mode));
+	} else {
+		opus_encoder_ctl(encoder, OPUS_SET_BITRATE(p_base->bitrate_bps));
+	}
+
+	frame_size = GodotOpus::calculate_frame_size(sampling_rate, p_base->frame_duration);
+	frame_pcm.resize(frame_size * (int)channels);
+	frame_fill = 0;
+	encode_data.resize(max_payload_bytes);
+
+	// Room for buffer_length_seconds of worst case packets, plus their length headers
+	float packets_per_second = (float)sampling_rate / frame_size;
+	float target_buffer_size = packets_per_second * (max_payload_bytes + 2) * p_base->buffer_length_seconds;
+	ERR_FAIL_COND_V(target_buffer_size <= 0 || target_buffer_size >= (1 << 27), false);
+	packet_queue.resize((int)target_buffer_size);
+
+	encoder_initialized = true;
+	return true;
+}
+
+void AudioEffectOpusCaptureInstance::_capture_frames(const AudioFrame *src, int frames) {
+	// Audio thread. Fill the current frame, encoding it each time it completes.
+	const int ch = (int)channels;
+	const int frame_samples = frame_size * ch;
+	const float *samples = reinterpret_cast<const float *>(src);
+
+	if (resampler.is_active()) {
+		// Convert the bus audio a block at a time, then resample it to the Opus rate
+		while (frames > 0) {
+			int count = MIN(frames, AudioResampler::BLOCK_FRAMES);
+			if (channels == GodotOpus::CHANNELS_STEREO) {
+				AudioKernels::interleave_stereo(samples, capture_pcm.ptr(), count);
+			} else {
+				AudioKernels::downmix_mono(samples, capture_pcm.ptr(), count);
+			}
+			samples += count * 2;
+			frames -= count;
+			_append_pcm(resampled_pcm.ptr(), resampler.process(capture_pcm.ptr(), count, resampled_pcm.ptr()));
+		}
+		return;
+	}
+
+	while (frames > 0) {
+		int count = MIN(frames, (frame_samples - frame_fill) / ch);
+		if (channels == GodotOpus::CHANNELS_STEREO) {
+			AudioKernels::interleave_stereo(samples, frame_pcm.ptr() + frame_fill, count);
+		} else {
+			AudioKernels::downmix_mono(samples, frame_pcm.ptr() + frame_fill, count);
+		}
+		samples += count * 2;
+		frames -= count;
+		frame_fill += count * ch;
+
+		if (frame_fill == frame_samples) {
+			_encode_frame();
+		}
+	}
+}
+
+void AudioEffectOpusCaptureInstance::_append_pcm(const float *pcm, int frames) {
+	// Audio thread. Same as above, for samples already in the encoder's layout.
+	const int ch = (int)channels;
+	const int frame_samples = frame_size * ch;
+
+	while (frames > 0) {
+		int count = MIN(frames, (frame_samples - frame_fill) / ch);
+		memcpy(frame_pcm.ptr() + frame_fill, pcm, sizeof(float) * count * ch);
+		pcm += count * ch;
+		frames -= count;
+		frame_fill += count * ch;
+
+		if (frame_fill == frame_samples) {
+			_encode_frame();
+		}
+	}
+}
+
+void AudioEffectOpusCaptureInstance::_encode_frame() {
+	// Audio thread. Encodes the full frame and publishes the packet, if there's room.
+	frame_fill = 0;
+	opus_int32 encoded_length = opus_encode_float(encoder, frame_pcm.ptr(), frame_size, encode_data.ptr(), max_payload_bytes);
+	if (encoded_length > 0 && !packet_queue.push(encode_data.ptr(), encoded_length)) {
+		dropped_packets.increment();
+	}
+}
+
+bool AudioEffectOpusCaptureInstance::has_packet() const {
+	return !packet_queue.is_empty();
+}
+
+PackedByteArray AudioEffectOpusCaptureInstance::get_packet() {
+	return packet_queue.pop();
+}
+
+Array AudioEffectOpusCaptureInstance::get_packets() {
+	Array ret;
+	while (has_packet()) {
+		ret.push_back(get_packet());
+	}
+	return ret;
+}
+
+void AudioEffectOpusCaptureInstance::clear_buffer() {
+	packet_queue.clear();
+}
+
+int AudioEffectOpusCaptureInstance::get_frame_size() const {
+	return frame_size;
+}
+
+int AudioEffectOpusCaptureInstance::get_dropped_packet_count() const {
+	return dropped_packets.get();
+}
+
+void AudioEffectOpusCaptureInstance::_bind_methods() {
+	ClassDB::bind_method(D_METHOD("has_packet"), &AudioEffectOpusCaptureInstance::has_packet);
+	ClassDB::bind_method(D_METHOD("get_packet"), &AudioEffectOpusCaptureInstance::get_packet);
+	ClassDB::bind_method(D_METHOD("get_packets"), &AudioEffectOpusCaptureInstance::get_packets);
+	ClassDB::bind_method(D_METHOD("clear_buffer"), &AudioEffectOpusCaptureInstance::clear_buffer);
+	ClassDB::bind_method(D_METHOD("get_frame_size"), &AudioEffectOpusCaptureInstance::get_frame_size);
+	ClassDB::bind_method(D_METHOD("get_dropped_packet_count"), &AudioEffectOpusCaptureInstance::get_dropped_packet_count);
+}
+
+// AudioEffectOpusCapture ///////////////////////////////////////////////////
+
+AudioEffectOpusCapture::AudioEffectOpusCapture() {
+	channels = GodotOpus::CHANNELS_STEREO;
+	application_mode = GodotOpus::APPLICATION_MODE_VOIP;
+	frame_duration = GodotOpus::FRAMESIZE_20_MS;
+	bitrate_mode = GodotOpus::BITRATE_VARIABLE_AUTO;
+	bitrate_bps = 120000;
+	encoder_complexity = 10;
+	dtx = false;
+	max_payload_bytes = 1024;
+	buffer_length_seconds = 0.5;
+}
+
+AudioEffectOpusCapture::~AudioEffectOpusCapture() {
+}
+
+Ref<AudioEffectInstance> AudioEffectOpusCapture::_instantiate() {
+	// A new instance never touches the state of one the bus may still be running
+	Ref<AudioEffectOpusCaptureInstance> ins;
+	ins.instantiate();
+	if (!ins->_initialize_encoder(this)) {
+		// The bus needs an instance either way; without an encoder it only
+		// passes the audio through
+		ERR_PRINT("AudioEffectOpusCapture failed to set up its encoder, the bus audio won't be encoded");
+	}
+	current_instance = ins;
+	return ins;
+}
+
+bool AudioEffectOpusCapture::has_packet() const {
+	return current_instance.is_valid() && current_instance->has_packet();
+}
+
+PackedByteArray AudioEffectOpusCapture::get_packet() {
+	if (current_instance.is_null()) {
+		return PackedByteArray();
+	}
+	return current_instance->get_packet();
+}
+
+Array AudioEffectOpusCapture::get_packets() {
+	if (current_instance.is_null()) {
+		return Array();
+	}
+	return current_instance->get_packets();
+}
+
+void AudioEffectOpusCapture::clear_buffer() {
+	if (current_instance.is_valid()) {
+		current_instance->clear_buffer();
+	}
+}
+
+int AudioEffectOpusCapture::get_frame_size() const {
+	if (current_instance.is_null()) {
+		return GodotOpus::calculate_frame_size(48000, frame_duration);
+	}
+	return current_instance->get_frame_size();
+}
+
+int AudioEffectOpusCapture::get_dropped_packet_count() const {
+	if (current_instance.is_null()) {
+		return 0;
+	}
+	return current_instance->get_dropped_packet_count();
+}
+
+// Getters and Setters ////////////////////////////////////////////////////////
+// Changes are applied the next time the effect is instantiated on a bus.
+
+void AudioEffectOpusCapture::set_channels(const GodotOpus::Channels p_channels) {
+	channels = p_channels;
+}
+
+GodotOpus::Channels AudioEffectOpusCapture::get_channels() const {
+	return channels;
+}
+
+void AudioEffectOpusCapture::set_application_mode(const GodotOpus::ApplicationMode p_application_mode) {
+	application_mode = p_application_mode;
+}
+
+GodotOpus::ApplicationMode AudioEffectOpusCapture::get_application_mode() const {
+	return application_mode;
+}
+
+void AudioEffectOpusCapture::set_frame_duration(const GodotOpus::FrameSizeDuration p_frame_duration) {
+	frame_duration = p_frame_duration;
+}
+
+GodotOpus::FrameSizeDuration AudioEffectOpusCapture::get_frame_duration() const {
+	return frame_duration;
+}
+
+void AudioEffectOpusCapture::set_bitrate_mode(const GodotOpus::BitrateMode p_mode) {
+	bitrate_mode = p_mode;
+}
+
+GodotOpus::BitrateMode AudioEffectOpusCapture::get_bitrate_mode() const {
+	return bitrate_mode;
+}
+
+void AudioEffectOpusCapture::set_bitrate(const int p_bitrate) {
+	bitrate_bps = p_bitrate;
+}
+
+int AudioEffectOpusCapture::get_bitrate() const {
+	return bitrate_bps;
+}
+
+void AudioEffectOpusCapture::set_encoder_complexity(const int p_complexity) {
+	encoder_complexity = p_complexity;
+}
+
+int AudioEffectOpusCapture::get_encoder_complexity() const {
+	return encoder_complexity;
+}
+
+void AudioEffectOpusCapture::set_dtx(const bool p_dtx) {
+	dtx = p_dtx;
+}
+
+bool AudioEffectOpusCapture::is_dtx() const {
+	return dtx;
+}
+
+void AudioEffectOpusCapture::set_max_payload_bytes(const int p_max_payload_bytes) {
+	ERR_FAIL_COND_MSG(p_max_payload_bytes <= 0 || p_max_payload_bytes > 0xFFFF, "max_payload_bytes outside valid range 1-65535");
+	max_payload_bytes = p_max_payload_bytes;
+}
+
+int AudioEffectOpusCapture::get_max_payload_bytes() const {
+	return max_payload_bytes;
+}
+
+void AudioEffectOpusCapture::set_buffer_length_seconds(const float p_buffer_length_seconds) {
+	buffer_length_seconds = p_buffer_length_seconds;
+}
+
+float AudioEffectOpusCapture::get_buffer_length_seconds() const {
+	return buffer_length_seconds;
+}
+
+// Bind methods
+
+void AudioEffectOpusCapture::_bind_methods() {
+	ClassDB::bind_method(D_METHOD("has_packet"), &AudioEffectOpusCapture::has_packet);
+	ClassDB::bind_method(D_METHOD("get_packet"), &AudioEffectOpusCapture::get_packet);
+	ClassDB::bind_method(D_METHOD("get_packets"), &AudioEffectOpusCapture::get_packets);
+	ClassDB::bind_method(D_METHOD("clear_buffer"), &AudioEffectOpusCapture::clear_buffer);
+	ClassDB::bind_method(D_METHOD("get_frame_size"), &AudioEffectOpusCapture::get_frame_size);
+	ClassDB::bind_method(D_METHOD("get_dropped_packet_count"), &AudioEffectOpusCapture::get_dropped_packet_count);
+
+	ClassDB::bind_method(D_METHOD("get_channels"), &AudioEffectOpusCapture::get_channels);
+	ClassDB::bind_method(D_METHOD("set_channels", "p_channels"), &AudioEffectOpusCapture::set_channels);
+	ClassDB::bind_method(D_METHOD("get_application_mode"), &AudioEffectOpusCapture::get_application_mode);
+	ClassDB::bind_method(D_METHOD("set_application_mode", "p_application_mode"), &AudioEffectOpusCapture::set_application_mode);
+	ClassDB::bind_method(D_METHOD("get_frame_duration"), &AudioEffectOpusCapture::get_frame_duration);
+	ClassDB::bind_method(D_METHOD("set_frame_duration", "p_frame_duration"), &AudioEffectOpusCapture::set_frame_duration);
+	ClassDB::bind_method(D_METHOD("get_bitrate_mode"), &AudioEffectOpusCapture::get_bitrate_mode);
+	ClassDB::bind_method(D_METHOD("set_bitrate_mode", "p_mode"), &AudioEffectOpusCapture::set_bitrate_mode);
+	ClassDB::bind_method(D_METHOD("get_bitrate"), &AudioEffectOpusCapture::get_bitrate);
+	ClassDB::bind_method(D_METHOD("set_bitrate", "p_bitrate"), &AudioEffectOpusCapture::set_bitrate);
+	ClassDB::bind_method(D_METHOD("get_encoder_complexity"), &AudioEffectOpusCapture::get_encoder_complexity);
+	ClassDB::bind_method(D_METHOD("set_encoder_complexity", "p_complexity"), &AudioEffectOpusCapture::set_encoder_complexity);
+	ClassDB::bind_method(D_METHOD("is_dtx"), &AudioEffectOpusCapture::is_dtx);
+	ClassDB::bind_method(D_METHOD("set_dtx", "p_dtx"), &AudioEffectOpusCapture::set_dtx);
+	ClassDB::bind_method(D_METHOD("get_max_payload_bytes"), &AudioEffectOpusCapture::get_max_payload_bytes);
+	ClassDB::bind_method(D_METHOD("set_max_payload_bytes", "p_max_payload_bytes"), &AudioEffectOpusCapture::set_max_payload_bytes);
+	ClassDB::bind_method(D_METHOD("get_buffer_length_seconds"), &AudioEffectOpusCapture::get_buffer_length_seconds);
+	ClassDB::bind_method(D_METHOD("set_buffer_length_seconds", "p_buffer_length_seconds"), &AudioEffectOpusCapture::set_buffer_length_seconds);
+
+	ClassDB::add_property("AudioEffectOpusCapture", PropertyInfo(Variant::INT, "channels", PROPERTY_HINT_ENUM, "Mono:1,Stereo:2"), "set_channels", "get_channels");
+	ClassDB::add_property("AudioEffectOpusCapture", PropertyInfo(Variant::INT, "application_mode", PROPERTY_HINT_ENUM, "VoIP:2048,Audio:2049,Restricted-LowDelay:2051"), "set_application_mode", "get_application_mode");
+	ClassDB::add_property("AudioEffectOpusCapture", PropertyInfo(Variant::INT, "frame_duration", PROPERTY_HINT_ENUM, "2.5 ms:5001,5 ms:5002,10 ms:5003,20 ms:5004,40 ms:5005,60 ms:5006,80 ms:5007,100 ms:5008,120 ms:5009"), "set_frame_duration", "get_frame_duration");
+	ClassDB::add_property("AudioEffectOpusCapture", PropertyInfo(Variant::INT, "bitrate_mode", PROPERTY_HINT_ENUM, "VBR Auto:-1000,VBR Max:-1,VBR Manual:0,CBR:1"), "set_bitrate_mode", "get_bitrate_mode");
+	ClassDB::add_property("AudioEffectOpusCapture", PropertyInfo(Variant::INT, "bitrate", PROPERTY_HINT_RANGE, "6000,512000,1000,exp,suffix:bps"), "set_bitrate", "get_bitrate");
+	ClassDB::add_property("AudioEffectOpusCapture", PropertyInfo(Variant::INT, "encoder_complexity", PROPERTY_HINT_RANGE, "0,10,1"), "set_encoder_complexity", "get_encoder_complexity");
+	ClassDB::add_property("AudioEffectOpusCapture", PropertyInfo(Variant::BOOL, "dtx"), "set_dtx", "is_dtx");
+	ClassDB::add_property("AudioEffectOpusCapture", PropertyInfo(Variant::INT, "max_payload_bytes", PROPERTY_HINT_RANGE, "16,2048,16,suffix:B"), "set_max_payload_bytes", "get_max_payload_bytes");
+	ClassDB::add_property("AudioEffectOpusCapture", PropertyInfo(Variant::FLOAT, "buffer_length_seconds", PROPERTY_HINT_RANGE, "0.01,10,0.01,exp,suffix:s"), "set_buffer_length_seconds", "get_buffer_length_seconds");
+}
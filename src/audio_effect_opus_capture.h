@@ -0,0 +1,140 @@
+#ifndef AUDIO_EFFECT_OPUS_CAPTURE_H
+#define AUDIO_EFFECT_OPUS_CAPTURE_H
+
+#include <opus.h>
+#include <godot_cpp/classes/audio_effect.hpp>
+#include <godot_cpp/classes/audio_effect_instance.hpp>
+#include <godot_cpp/classes/audio_frame.hpp>
+#include <godot_cpp/templates/local_vector.hpp>
+#include <godot_cpp/templates/safe_refcount.hpp>
+
+#include "audio_resampler.h"
+#include "godot_opus.h"
+#include "packet_queue.h"
+
+namespace godot {
+
+class AudioEffectOpusCapture;
+
+class AudioEffectOpusCaptureInstance : public AudioEffectInstance {
+	GDCLASS(AudioEffectOpusCaptureInstance, AudioEffectInstance)
+	friend class AudioEffectOpusCapture;
+
+	// Each instance has its own encoder and queue, as the bus creates one per
+	// channel pair and re-instantiates the effect while old instances still run
+	OpusEncoder *encoder;
+	bool encoder_initialized;
+
+	// Audio thread only: the frame currently being filled, and encode scratch
+	LocalVector<float> frame_pcm;
+	int frame_fill;
+	LocalVector<uint8_t> encode_data;
+
+	// Audio thread only: converts the bus audio when the mix rate isn't an Opus rate
+	AudioResampler resampler;
+	LocalVector<float> capture_pcm;
+	LocalVector<float> resampled_pcm;
+
+	// Audio thread writes, game thread reads
+	PacketQueue packet_queue;
+	SafeNumeric<uint32_t> dropped_packets;
+
+	// Taken from the effect's properties when instantiated
+	int sampling_rate;
+	GodotOpus::Channels channels;
+	int max_payload_bytes;
+	int frame_size;
+
+	bool _initialize_encoder(const AudioEffectOpusCapture *p_base);
+	void _capture_frames(const AudioFrame *src, int frames);
+	void _append_pcm(const float *pcm, int frames);
+	void _encode_frame();
+
+protected:
+	static void _bind_methods();
+
+public:
+	AudioEffectOpusCaptureInstance();
+	~AudioEffectOpusCaptureInstance();
+
+	virtual void _process(const void *src_buffer, AudioFrame *dst_buffer, int32_t frame_count) override;
+	virtual bool _process_silence() const override;
+
+	bool has_packet() const;
+	PackedByteArray get_packet();
+	Array get_packets();
+	void clear_buffer();
+
+	int get_frame_size() const;
+	int get_dropped_packet_count() const;
+};
+
+// Encodes the audio passing through a bus straight on the audio thread. Finished
+// packets are published to a lock-free queue, to be read by the game with
+// get_packet(). Like AudioEffectCapture, only one bus should use each effect.
+class AudioEffectOpusCapture : public AudioEffect {
+	GDCLASS(AudioEffectOpusCapture, AudioEffect)
+	friend class AudioEffectOpusCaptureInstance;
+
+	// The instance created last, which get_packet() reads from. On a surround
+	// bus the other channel pairs have their own, see get_bus_effect_instance().
+	Ref<AudioEffectOpusCaptureInstance> current_instance;
+
+	GodotOpus::Channels channels;
+	GodotOpus::ApplicationMode application_mode;
+	GodotOpus::FrameSizeDuration frame_duration;
+	GodotOpus::BitrateMode bitrate_mode;
+	int bitrate_bps;
+	int encoder_complexity;
+	bool dtx;
+	int max_payload_bytes;
+	float buffer_length_seconds;
+
+protected:
+	static void _bind_methods();
+
+public:
+	AudioEffectOpusCapture();
+	~AudioEffectOpusCapture();
+
+	virtual Ref<AudioEffectInstance> _instantiate() override;
+
+	bool has_packet() const;
+	PackedByteArray get_packet();
+	Array get_packets();
+	void clear_buffer();
+
+	int get_frame_size() const;
+	int get_dropped_packet_count() const;
+
+	void set_channels(const GodotOpus::Channels p_channels);
+	GodotOpus::Channels get_channels() const;
+
+	void set_application_mode(const GodotOpus::ApplicationMode p_application_mode);
+	GodotOpus::ApplicationMode get_application_mode() const;
+
+	void set_frame_duration(const GodotOpus::FrameSizeDuration p_frame_duration);
+	GodotOpus::FrameSizeDuration get_frame_duration() const;
+
+	void set_bitrate_mode(const GodotOpus::BitrateMode p_mode);
+	GodotOpus::BitrateMode get_bitrate_mode() const;
+
+	void set_bitrate(const int p_bitrate);
+	int get_bitrate() const;
+
+	void set_encoder_complexity(const int p_complexity);
+	int get_encoder_complexity() const;
+
+	void set_dtx(const bool p_dtx);
+	bool is_dtx() const;
+
+	void set_max_payload_bytes(const int p_max_payload_bytes);
+	int get_max_payload_bytes() const;
+
+	void set_buffer_length_seconds(const float p_buffer_length_seconds);
+	float get_buffer_length_seconds() const;
+};
+
+} //namespace godot
+
+#endif // AUDIO_EFFECT_OPUS_CAPTURE_H
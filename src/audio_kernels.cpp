@@ -0,0 +1,210 @@
+
+#include "audio_kernels.h"
+
+#include <string.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define AUDIO_KERNELS_AVX2
+#define AUDIO_KERNELS_SSE2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define AUDIO_KERNELS_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define AUDIO_KERNELS_NEON
+#endif
+
+using namespace godot;
+
+void AudioKernels::interleave_stereo(const float *p_src, float *p_dst, int p_frames) {
+	memcpy(p_dst, p_src, sizeof(float) * 2 * p_frames);
+}
+
+void AudioKernels::downmix_mono(const float *p_src, float *p_dst, int p_frames) {
+	const float *src = p_src;
+	int i = 0;
+#if defined(AUDIO_KERNELS_AVX2)
+	const __m256 half8 = _mm256_set1_ps(0.5f);
+	for (; i + 8 <= p_frames; i += 8) {
+		__m256 a = _mm256_loadu_ps(src + i * 2);
+		__m256 b = _mm256_loadu_ps(src + i * 2 + 8);
+		// Per 128-bit lane: [l0 l1 l4 l5 | l2 l3 l6 l7], then fix the lane order
+		__m256 l = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+		__m256 r = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+		__m256 m = _mm256_mul_ps(_mm256_add_ps(l, r), half8);
+		m = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(m), _MM_SHUFFLE(3, 1, 2, 0)));
+		_mm256_storeu_ps(p_dst + i, m);
+	}
+#endif
+#if defined(AUDIO_KERNELS_SSE2)
+	const __m128 half4 = _mm_set1_ps(0.5f);
+	for (; i + 4 <= p_frames; i += 4) {
+		__m128 a = _mm_loadu_ps(src + i * 2);
+		__m128 b = _mm_loadu_ps(src + i * 2 + 4);
+		__m128 l = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+		__m128 r = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+		_mm_storeu_ps(p_dst + i, _mm_mul_ps(_mm_add_ps(l, r), half4));
+	}
+#elif defined(AUDIO_KERNELS_NEON)
+	for (; i + 4 <= p_frames; i += 4) {
+		float32x4x2_t lr = vld2q_f32(src + i * 2);
+		vst1q_f32(p_dst + i, vmulq_n_f32(vaddq_f32(lr.val[0], lr.val[1]), 0.5f));
+	}
+#endif
+	for (; i < p_frames; i++) {
+		p_dst[i] = (src[i * 2] + src[i * 2 + 1]) * 0.5f;
+	}
+}
+
+void AudioKernels::mix_gain(const float *p_src, float *p_dst, float p_gain, int p_samples) {
+	int i = 0;
+#if defined(AUDIO_KERNELS_AVX2)
+	const __m256 gain8 = _mm256_set1_ps(p_gain);
+	for (; i + 8 <= p_samples; i += 8) {
+		__m256 d = _mm256_loadu_ps(p_dst + i);
+		_mm256_storeu_ps(p_dst + i, _mm256_add_ps(d, _mm256_mul_ps(_mm256_loadu_ps(p_src + i), gain8)));
+	}
+#endif
+#if defined(AUDIO_KERNELS_SSE2)
+	const __m128 gain4 = _mm_set1_ps(p_gain);
+	for (; i + 4 <= p_samples; i += 4) {
+		__m128 d = _mm_loadu_ps(p_dst + i);
+		_mm_storeu_ps(p_dst + i, _mm_add_ps(d, _mm_mul_ps(_mm_loadu_ps(p_src + i), gain4)));
+	}
+#elif defined(AUDIO_KERNELS_NEON)
+	for (; i + 4 <= p_samples; i += 4) {
+		vst1q_f32(p_dst + i, vmlaq_n_f32(vld1q_f32(p_dst + i), vld1q_f32(p_src + i), p_gain));
+	}
+#endif
+	for (; i < p_samples; i++) {
+		p_dst[i] += p_src[i] * p_gain;
+	}
+}
+
+float AudioKernels::dot(const float *p_a, const float *p_b, int p_samples) {
+	int i = 0;
+	float sum = 0.0f;
+#if defined(AUDIO_KERNELS_AVX2)
+	__m256 acc8 = _mm256_setzero_ps();
+	for (; i + 8 <= p_samples; i += 8) {
+		acc8 = _mm256_add_ps(acc8, _mm256_mul_ps(_mm256_loadu_ps(p_a + i), _mm256_loadu_ps(p_b + i)));
+	}
+	__m128 acc4 = _mm_add_ps(_mm256_castps256_ps128(acc8), _mm256_extractf128_ps(acc8, 1));
+#elif defined(AUDIO_KERNELS_SSE2)
+	__m128 acc4 = _mm_setzero_ps();
+#endif
+#if defined(AUDIO_KERNELS_SSE2)
+	for (; i + 4 <= p_samples; i += 4) {
+		acc4 = _mm_add_ps(acc4, _mm_mul_ps(_mm_loadu_ps(p_a + i), _mm_loadu_ps(p_b + i)));
+	}
+	// Horizontal sum of the four lanes
+	acc4 = _mm_add_ps(acc4, _mm_movehl_ps(acc4, acc4));
+	acc4 = _mm_add_ss(acc4, _mm_shuffle_ps(acc4, acc4, _MM_SHUFFLE(1, 1, 1, 1)));
+	sum = _mm_cvtss_f32(acc4);
+#elif defined(AUDIO_KERNELS_NEON)
+	float32x4_t acc4 = vdupq_n_f32(0.0f);
+	for (; i + 4 <= p_samples; i += 4) {
+		acc4 = vmlaq_f32(acc4, vld1q_f32(p_a + i), vld1q_f32(p_b + i));
+	}
+	float32x2_t acc2 = vadd_f32(vget_low_f32(acc4), vget_high_f32(acc4));
+	sum = vget_lane_f32(vpadd_f32(acc2, acc2), 0);
+#endif
+	for (; i < p_samples; i++) {
+		sum += p_a[i] * p_b[i];
+	}
+	return sum;
+}
+
+#ifndef REAL_T_IS_DOUBLE
+
+// real_t == float: Vector2 is already an interleaved pair of floats.
+static_assert(sizeof(Vector2) == 2 * sizeof(float), "Vector2 must be two packed floats");
+
+void AudioKernels::interleave_stereo(const Vector2 *p_src, float *p_dst, int p_frames) {
+	interleave_stereo(reinterpret_cast<const float *>(p_src), p_dst, p_frames);
+}
+
+void AudioKernels::downmix_mono(const Vector2 *p_src, float *p_dst, int p_frames) {
+	downmix_mono(reinterpret_cast<const float *>(p_src), p_dst, p_frames);
+}
+
+void AudioKernels::deinterleave_stereo(const float *p_src, Vector2 *p_dst, int p_frames) {
+	memcpy(reinterpret_cast<float *>(p_dst), p_src, sizeof(float) * 2 * p_frames);
+}
+
+#else // REAL_T_IS_DOUBLE
+
+// real_t == double: every sample has to be narrowed to float on the way in.
+static_assert(sizeof(Vector2) == 2 * sizeof(double), "Vector2 must be two packed doubles");
+
+void AudioKernels::interleave_stereo(const Vector2 *p_src, float *p_dst, int p_frames) {
+	const double *src = reinterpret_cast<const double *>(p_src);
+	const int samples = p_frames * 2;
+	int i = 0;
+#if defined(AUDIO_KERNELS_AVX2)
+	for (; i + 4 <= samples; i += 4) {
+		_mm_storeu_ps(p_dst + i, _mm256_cvtpd_ps(_mm256_loadu_pd(src + i)));
+	}
+#endif
+#if defined(AUDIO_KERNELS_SSE2)
+	for (; i + 4 <= samples; i += 4) {
+		__m128 lo = _mm_cvtpd_ps(_mm_loadu_pd(src + i));
+		__m128 hi = _mm_cvtpd_ps(_mm_loadu_pd(src + i + 2));
+		_mm_storeu_ps(p_dst + i, _mm_movelh_ps(lo, hi));
+	}
+#elif defined(AUDIO_KERNELS_NEON) && defined(__aarch64__)
+	for (; i + 4 <= samples; i += 4) {
+		float32x2_t lo = vcvt_f32_f64(vld1q_f64(src + i));
+		float32x2_t hi = vcvt_f32_f64(vld1q_f64(src + i + 2));
+		vst1q_f32(p_dst + i, vcombine_f32(lo, hi));
+	}
+#endif
+	for (; i < samples; i++) {
+		p_dst[i] = (float)src[i];
+	}
+}
+
+void AudioKernels::downmix_mono(const Vector2 *p_src, float *p_dst, int p_frames) {
+	const double *src = reinterpret_cast<const double *>(p_src);
+	int i = 0;
+#if defined(AUDIO_KERNELS_AVX2)
+	const __m256d half4 = _mm256_set1_pd(0.5);
+	for (; i + 4 <= p_frames; i += 4) {
+		__m256d a = _mm256_loadu_pd(src + i * 2); // l0 r0 l1 r1
+		__m256d b = _mm256_loadu_pd(src + i * 2 + 4); // l2 r2 l3 r3
+		__m256d l = _mm256_unpacklo_pd(a, b); // l0 l2 l1 l3
+		__m256d r = _mm256_unpackhi_pd(a, b); // r0 r2 r1 r3
+		__m256d m = _mm256_permute4x64_pd(_mm256_mul_pd(_mm256_add_pd(l, r), half4), _MM_SHUFFLE(3, 1, 2, 0));
+		_mm_storeu_ps(p_dst + i, _mm256_cvtpd_ps(m));
+	}
+#endif
+#if defined(AUDIO_KERNELS_SSE2)
+	const __m128d half2 = _mm_set1_pd(0.5);
+	for (; i + 2 <= p_frames; i += 2) {
+		__m128d a = _mm_loadu_pd(src + i * 2); // l0 r0
+		__m128d b = _mm_loadu_pd(src + i * 2 + 2); // l1 r1
+		__m128d m = _mm_mul_pd(_mm_add_pd(_mm_unpacklo_pd(a, b), _mm_unpackhi_pd(a, b)), half2);
+		_mm_storel_pi(reinterpret_cast<__m64 *>(p_dst + i), _mm_cvtpd_ps(m));
+	}
+#elif defined(AUDIO_KERNELS_NEON) && defined(__aarch64__)
+	for (; i + 2 <= p_frames; i += 2) {
+		float64x2x2_t lr = vld2q_f64(src + i * 2);
+		vst1_f32(p_dst + i, vcvt_f32_f64(vmulq_n_f64(vaddq_f64(lr.val[0], lr.val[1]), 0.5)));
+	}
+#endif
+	for (; i < p_frames; i++) {
+		p_dst[i] = (float)((src[i * 2] + src[i * 2 + 1]) * 0.5);
+	}
+}
+
+void AudioKernels::deinterleave_stereo(const float *p_src, Vector2 *p_dst, int p_frames) {
+	// Widening to double; compilers vectorize this loop on their own
+	double *dst = reinterpret_cast<double *>(p_dst);
+	const int samples = p_frames * 2;
+	for (int i = 0; i < samples; i++) {
+		dst[i] = (double)p_src[i];
+	}
+}
+
+#endif // REAL_T_IS_DOUBLE
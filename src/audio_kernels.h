@@ -0,0 +1,36 @@
+#ifndef GODOT_OPUS_AUDIO_KERNELS_H
+#define GODOT_OPUS_AUDIO_KERNELS_H
+
+#include <godot_cpp/variant/vector2.hpp>
+
+namespace godot {
+
+// Vectorized sample conversion kernels. SSE2 is used on x86_64 and NEON on
+// arm64 (both baseline for those targets), AVX2 when the build enables it,
+// with a scalar fallback elsewhere. All kernels handle real_t == double.
+namespace AudioKernels {
+
+// Copies p_frames stereo frames into interleaved float samples (2 * p_frames).
+void interleave_stereo(const Vector2 *p_src, float *p_dst, int p_frames);
+
+// Averages the channels of p_frames stereo frames into p_frames mono samples.
+void downmix_mono(const Vector2 *p_src, float *p_dst, int p_frames);
+
+// Same as above, for frames that are already interleaved float pairs (e.g. AudioFrame).
+void interleave_stereo(const float *p_src, float *p_dst, int p_frames);
+void downmix_mono(const float *p_src, float *p_dst, int p_frames);
+
+// Copies p_frames interleaved float pairs out into stereo frames.
+void deinterleave_stereo(const float *p_src, Vector2 *p_dst, int p_frames);
+
+// Adds p_samples samples scaled by p_gain onto p_dst (p_dst += p_src * p_gain).
+void mix_gain(const float *p_src, float *p_dst, float p_gain, int p_samples);
+
+// Returns the sum of p_a[i] * p_b[i] over p_samples samples.
+float dot(const float *p_a, const float *p_b, int p_samples);
+
+} // namespace AudioKernels
+
+} //namespace godot
+
+#endif // GODOT_OPUS_AUDIO_KERNELS_H
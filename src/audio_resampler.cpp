@@ -0,0 +1,142 @@
+#include <math.h>
+#include <string.h>
+
+#include <godot_cpp/core/error_macros.hpp>
+#include <godot_cpp/core/math.hpp>
+
+#include "audio_kernels.h"
+#include "audio_resampler.h"
+
+using namespace godot;
+
+// The top 8 bits of the fractional position pick the phase, the rest blend to the next
+static_assert(AudioResampler::PHASES == 256, "Phase lookup assumes 256 phases");
+
+// Passband edge, as a fraction of the lower of the two Nyquist frequencies
+static constexpr double ROLLOFF = 0.92;
+
+void AudioResampler::_build_filter(const double p_cutoff) {
+	// Phase p is the filter for an output frame that falls p / PHASES of the way
+	// between input frames TAPS / 2 - 1 and TAPS / 2 of the window
+	coefs.resize((PHASES + 1) * TAPS);
+	deltas.resize(PHASES * TAPS);
+	kernel.resize(TAPS);
+
+	const double half = TAPS / 2;
+	for (int p = 0; p <= PHASES; p++) {
+		float *phase = coefs.ptr() + p * TAPS;
+		double sum = 0.0;
+		for (int k = 0; k < TAPS; k++) {
+			const double x = k - (half - 1) - (double)p / PHASES;
+			const double sinc = x == 0.0 ? 1.0 : sin(Math_PI * p_cutoff * x) / (Math_PI * p_cutoff * x);
+			// Blackman window over the TAPS wide span
+			const double w = CLAMP(x / half, -1.0, 1.0);
+			const double window = 0.42 + 0.5 * cos(Math_PI * w) + 0.08 * cos(2.0 * Math_PI * w);
+			const double c = p_cutoff * sinc * window;
+			phase[k] = (float)c;
+			sum += c;
+		}
+		// Unity gain at DC for every phase
+		for (int k = 0; k < TAPS; k++) {
+			phase[k] = (float)(phase[k] / sum);
+		}
+	}
+
+	for (int i = 0; i < PHASES * TAPS; i++) {
+		deltas[i] = coefs[i + TAPS] - coefs[i];
+	}
+}
+
+void AudioResampler::setup(const int p_input_rate, const int p_output_rate, const int p_channels, const bool p_variable_ratio) {
+	ERR_FAIL_COND_MSG(p_channels < 0 || p_input_rate <= 0 || p_output_rate <= 0, "Invalid resampler configuration");
+	input_rate = p_input_rate;
+	output_rate = p_output_rate;
+	channels = p_channels;
+	variable_ratio = p_variable_ratio;
+	if (!is_active()) {
+		return;
+	}
+
+	base_step = ((uint64_t)input_rate << 32) / output_rate;
+	step = base_step;
+	history.resize(channels * (TAPS + BLOCK_FRAMES));
+	_build_filter(ROLLOFF * MIN(1.0, (double)output_rate / input_rate));
+	reset();
+}
+
+void AudioResampler::set_ratio_scale(const double p_scale) {
+	ERR_FAIL_COND(!variable_ratio);
+	const double scale = CLAMP(p_scale, 1.0 - MAX_RATIO_SCALE, 1.0 + MAX_RATIO_SCALE);
+	step = (uint64_t)(base_step * scale);
+}
+
+void AudioResampler::reset() {
+	// Start with half a window of silence, so the first output frame lines up
+	// with the first input frame
+	history_frames = TAPS / 2 - 1;
+	position = 0;
+	if (!history.is_empty()) {
+		memset(history.ptr(), 0, sizeof(float) * history.size());
+	}
+}
+
+int AudioResampler::get_max_output(const int p_input_frames) const {
+	if (!is_active()) {
+		return p_input_frames;
+	}
+	// Less than a window of input is carried over between calls. A variable
+	// ratio may be scaled down to produce up to MAX_RATIO_SCALE more output.
+	const double max_output_rate = output_rate * (variable_ratio ? 1.0 + MAX_RATIO_SCALE : 1.0);
+	return (int)((p_input_frames + TAPS) * max_output_rate / input_rate) + 2;
+}
+
+int AudioResampler::process(const float *p_src, int p_frames, float *p_dst) {
+	ERR_FAIL_COND_V(!is_active(), 0);
+
+	const int stride = TAPS + BLOCK_FRAMES;
+	int written = 0;
+
+	while (p_frames > 0) {
+		const int count = MIN(p_frames, BLOCK_FRAMES);
+		for (int c = 0; c < channels; c++) {
+			float *h = history.ptr() + c * stride + history_frames;
+			for (int i = 0; i < count; i++) {
+				h[i] = p_src[i * channels + c];
+			}
+		}
+		history_frames += count;
+		p_src += count * channels;
+		p_frames -= count;
+
+		while ((int)(position >> 32) + TAPS <= history_frames) {
+			const uint32_t frac = (uint32_t)position;
+			const int phase = frac >> 24;
+			const float t = (frac & 0xFFFFFF) * (1.0f / 16777216.0f);
+
+			float *k = kernel.ptr();
+			memcpy(k, coefs.ptr() + phase * TAPS, sizeof(float) * TAPS);
+			AudioKernels::mix_gain(deltas.ptr() + phase * TAPS, k, t, TAPS);
+
+			const int start = (int)(position >> 32);
+			for (int c = 0; c < channels; c++) {
+				p_dst[written * channels + c] = AudioKernels::dot(history.ptr() + c * stride + start, k, TAPS);
+			}
+			written++;
+			position += step;
+		}
+
+		// Keep the frames the next window still needs. When downsampling, the
+		// position can already be past the end of the history.
+		const int consumed = MIN((int)(position >> 32), history_frames);
+		if (consumed > 0) {
+			for (int c = 0; c < channels; c++) {
+				float *h = history.ptr() + c * stride;
+				memmove(h, h + consumed, sizeof(float) * (history_frames - consumed));
+			}
+			history_frames -= consumed;
+			position -= (uint64_t)consumed << 32;
+		}
+	}
+
+	return written;
+}
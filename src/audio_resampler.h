@@ -0,0 +1,121 @@
+#ifndef AUDIO_RESAMPLER_H
+#define AUDIO_RESAMPLER_H
+
+#include <godot_cpp/core/math.hpp>
+#include <godot_cpp/templates/local_vector.hpp>
+
+#include <cstdint>
+
+namespace godot {
+
+// Streaming sample rate converter for interleaved float audio, using a windowed
+// sinc filter with PHASES precomputed phases, linearly interpolated between.
+// Every output frame costs the same (TAPS multiply-adds per channel, plus the
+// phase blend), whatever the two rates are. Nothing is allocated after setup(),
+// so process() is safe to call from the audio thread.
+class AudioResampler {
+public:
+	static constexpr int TAPS = 32;
+	static constexpr int PHASES = 256;
+	// process() works through its input this many frames at a time
+	static constexpr int BLOCK_FRAMES = 512;
+	// Largest deviation set_ratio_scale() allows from the nominal ratio
+	static constexpr double MAX_RATIO_SCALE = 0.01;
+
+private:
+	int channels = 0;
+	int input_rate = 0;
+	int output_rate = 0;
+	bool variable_ratio = false;
+
+	// Input frames advanced per output frame, and the read position relative
+	// to the start of history, both 32.32 fixed point. base_step is the step
+	// at the nominal ratio.
+	uint64_t base_step = 0;
+	uint64_t step = 0;
+	uint64_t position = 0;
+
+	// Planar input history, TAPS + BLOCK_FRAMES frames per channel
+	LocalVector<float> history;
+	int history_frames = 0;
+
+	// PHASES + 1 phases of TAPS coefficients, and the difference from each
+	// phase to the next for interpolating between them
+	LocalVector<float> coefs;
+	LocalVector<float> deltas;
+	LocalVector<float> kernel;
+
+	void _build_filter(const double p_cutoff);
+
+public:
+	// Configures the conversion and resets the stream. Equal rates (or zero
+	// channels) leave the resampler inactive, unless p_variable_ratio asks for
+	// the ratio to be adjusted later with set_ratio_scale().
+	void setup(const int p_input_rate, const int p_output_rate, const int p_channels, const bool p_variable_ratio = false);
+	void reset();
+
+	// Scales the input frames consumed per output frame, within MAX_RATIO_SCALE
+	// of 1.0. Above 1.0 the output is shorter (and slightly higher pitched).
+	void set_ratio_scale(const double p_scale);
+
+	bool is_active() const { return channels > 0 && (input_rate != output_rate || variable_ratio); }
+	int get_input_rate() const { return input_rate; }
+	int get_output_rate() const { return output_rate; }
+	int get_channels() const { return channels; }
+
+	// Upper bound on the frames process() can return for p_input_frames of input
+	int get_max_output(const int p_input_frames) const;
+
+	// Resamples p_frames interleaved frames from p_src into p_dst, which needs
+	// room for get_max_output(p_frames) frames. Returns the frames written.
+	int process(const float *p_src, int p_frames, float *p_dst);
+};
+
+// Turns measurements of how much audio is buffered ahead of playout into a
+// small resampling ratio correction, so a receiver follows the sender's clock
+// and holds its playout latency near a target instead of slowly running dry
+// or piling up delay. Proportional control on a smoothed latency, which is
+// enough for clock drift of a few hundred ppm.
+class DriftCompensator {
+	double target_ms = 0.0;
+	double latency_ms = 0.0;
+	double scale = 1.0;
+	bool measured = false;
+
+public:
+	// Corrections stay within half a percent, too little to hear as a pitch change
+	static constexpr double MAX_ADJUST = 0.005;
+	// Ratio correction per unit of relative latency error
+	static constexpr double GAIN = 0.02;
+	// Weight of each measurement in the smoothed latency
+	static constexpr double SMOOTHING = 0.05;
+
+	void set_target_ms(const double p_target_ms) { target_ms = p_target_ms; }
+	double get_target_ms() const { return target_ms; }
+	bool is_enabled() const { return target_ms > 0.0; }
+
+	void reset() {
+		latency_ms = 0.0;
+		scale = 1.0;
+		measured = false;
+	}
+
+	// Feeds a measurement, returning the ratio scale to apply (> 1.0 drains the buffer)
+	double update(const double p_latency_ms) {
+		if (!is_enabled()) {
+			return 1.0;
+		}
+		latency_ms = measured ? latency_ms + SMOOTHING * (p_latency_ms - latency_ms) : p_latency_ms;
+		measured = true;
+		const double error = (latency_ms - target_ms) / target_ms;
+		scale = 1.0 + CLAMP(error * GAIN, -MAX_ADJUST, MAX_ADJUST);
+		return scale;
+	}
+
+	double get_latency_ms() const { return latency_ms; }
+	double get_scale() const { return scale; }
+};
+
+} //namespace godot
+
+#endif // AUDIO_RESAMPLER_H
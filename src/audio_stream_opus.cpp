@@ -0,0 +1,341 @@
+
+#include <string.h>
+
+#include <godot_cpp/core/class_db.hpp>
+
+#include "audio_stream_opus.h"
+
+using namespace godot;
+
+// AudioStreamPlaybackOpus //////////////////////////////////////////////////
+
+AudioStreamPlaybackOpus::AudioStreamPlaybackOpus() {
+	decoder = NULL;
+	channels = GodotOpus::CHANNELS_STEREO;
+	sampling_rate = 48000;
+	frame_size = 960;
+	max_concealed_frames = 5;
+
+	pcm_pos = 0;
+	pcm_len = 0;
+	concealed_frames = 0;
+	mixed_samples = 0;
+	active = false;
+	rate_scale = 1.0;
+}
+
+AudioStreamPlaybackOpus::~AudioStreamPlaybackOpus() {
+	if (decoder != NULL) {
+		opus_decoder_destroy(decoder);
+		decoder = NULL;
+	}
+}
+
+bool AudioStreamPlaybackOpus::push_packet(const PackedByteArray &data) {
+	ERR_FAIL_NULL_V_MSG(decoder, false, "AudioStreamPlaybackOpus decoder not initialized");
+	ERR_FAIL_COND_V_MSG(data.is_empty(), false, "Use push_lost_packet to report a lost packet");
+	ERR_FAIL_COND_V_MSG(data.size() > PacketQueue::MAX_PACKET_SIZE, false, "Opus packet too large");
+
+	if (!packet_queue.push(data.ptr(), data.size())) {
+		return false;
+	}
+	queued_packets.increment();
+	return true;
+}
+
+bool AudioStreamPlaybackOpus::push_lost_packet() {
+	ERR_FAIL_NULL_V_MSG(decoder, false, "AudioStreamPlaybackOpus decoder not initialized");
+
+	// An empty packet tells the mixer to conceal a frame in its place
+	if (!packet_queue.push(NULL, 0)) {
+		return false;
+	}
+	queued_packets.increment();
+	return true;
+}
+
+bool AudioStreamPlaybackOpus::can_push_packet(const int size) const {
+	return packet_queue.space_left() >= size;
+}
+
+int AudioStreamPlaybackOpus::get_queued_packet_count() const {
+	return queued_packets.get();
+}
+
+int AudioStreamPlaybackOpus::get_underrun_count() const {
+	return underruns.get();
+}
+
+float AudioStreamPlaybackOpus::get_playout_latency_ms() const {
+	return playout_latency_usec.get() / 1000.0f;
+}
+
+void AudioStreamPlaybackOpus::clear_buffer() {
+	// Only safe while not playing; the queue is consumed by the audio thread
+	ERR_FAIL_COND_MSG(active, "Cannot clear AudioStreamPlaybackOpus buffer while playing");
+	packet_queue.clear();
+	queued_packets.set(0);
+}
+
+void AudioStreamPlaybackOpus::_start(double from_pos) {
+	// Don't conceal anything until the first packet has been decoded
+	concealed_frames = max_concealed_frames;
+	pcm_pos = 0;
+	pcm_len = 0;
+	mixed_samples = 0;
+	drift.reset();
+	rate_scale = 1.0;
+	active = true;
+	begin_resample();
+}
+
+void AudioStreamPlaybackOpus::_stop() {
+	active = false;
+}
+
+bool AudioStreamPlaybackOpus::_is_playing() const {
+	return active;
+}
+
+int32_t AudioStreamPlaybackOpus::_get_loop_count() const {
+	return 0;
+}
+
+double AudioStreamPlaybackOpus::_get_playback_position() const {
+	return (double)mixed_samples / sampling_rate;
+}
+
+void AudioStreamPlaybackOpus::_seek(double position) {
+	// Live stream, can't seek
+}
+
+double AudioStreamPlaybackOpus::_get_stream_sampling_rate() const {
+	// Read by the resampler on every mix, so drift corrections apply right away
+	return sampling_rate * rate_scale;
+}
+
+int32_t AudioStreamPlaybackOpus::_mix_resampled(AudioFrame *dst_buffer, int32_t frame_count) {
+	// Audio thread. Copy out decoded samples, decoding more as they run out.
+	int filled = 0;
+	while (filled < frame_count) {
+		if (pcm_pos >= pcm_len && !_decode_next()) {
+			// Nothing left to play or conceal
+			for (; filled < frame_count; filled++) {
+				dst_buffer[filled].left = 0.0;
+				dst_buffer[filled].right = 0.0;
+			}
+			break;
+		}
+
+		const int count = MIN(frame_count - filled, pcm_len - pcm_pos);
+		AudioFrame *dst = dst_buffer + filled;
+		if (channels == GodotOpus::CHANNELS_STEREO) {
+			memcpy(dst, decode_pcm.ptr() + pcm_pos * 2, sizeof(float) * 2 * count);
+		} else {
+			const float *src = decode_pcm.ptr() + pcm_pos;
+			for (int i = 0; i < count; i++) {
+				dst[i].left = src[i];
+				dst[i].right = src[i];
+			}
+		}
+		pcm_pos += count;
+		filled += count;
+	}
+
+	mixed_samples += frame_count;
+	return frame_count;
+}
+
+bool AudioStreamPlaybackOpus::_decode_next() {
+	pcm_pos = 0;
+	pcm_len = 0;
+
+	int samples;
+	int length = packet_queue.pop(packet_data.ptr(), (int)packet_data.size());
+	if (length >= 0) {
+		queued_packets.decrement();
+		if (length > 0) {
+			samples = _decode_packet(packet_data.ptr(), length);
+			concealed_frames = 0;
+		} else {
+			// Packet reported lost; recover it from the next packet's FEC data if that's queued
+			int next_length = packet_queue.peek(fec_data.ptr(), (int)fec_data.size());
+			if (next_length > 0 && opus_packet_has_lbrr(fec_data.ptr() + 2, next_length) == 1) {
+				samples = opus_decode_float(decoder, fec_data.ptr() + 2, next_length, decode_pcm.ptr(), frame_size, 1);
+			} else {
+				samples = _decode_packet(NULL, 0);
+			}
+		}
+	} else {
+		// Queue underrun; conceal a few frames, then give up until packets arrive
+		if (concealed_frames >= max_concealed_frames) {
+			return false;
+		}
+		if (concealed_frames == 0) {
+			underruns.increment();
+		}
+		concealed_frames++;
+		samples = _decode_packet(NULL, 0);
+	}
+
+	if (samples <= 0) {
+		return false;
+	}
+	pcm_len = samples;
+
+	// Measured once per frame, as it starts playing, so the reading doesn't
+	// saw-tooth with the position inside the frame
+	const int buffered = (int)queued_packets.get() * frame_size + pcm_len;
+	const double latency_ms = buffered * 1000.0 / sampling_rate;
+	playout_latency_usec.set((uint32_t)(latency_ms * 1000.0));
+	if (drift.is_enabled()) {
+		rate_scale = drift.update(latency_ms);
+	}
+	return true;
+}
+
+int AudioStreamPlaybackOpus::_decode_packet(const uint8_t *data, int length) {
+	// A NULL packet runs packet loss concealment for one frame
+	const int max_samples = data != NULL ? (int)decode_pcm.size() / (int)channels : frame_size;
+	int samples = opus_decode_float(decoder, data, length, decode_pcm.ptr(), max_samples, 0);
+	return samples;
+}
+
+void AudioStreamPlaybackOpus::_bind_methods() {
+	ClassDB::bind_method(D_METHOD("push_packet", "data"), &AudioStreamPlaybackOpus::push_packet);
+	ClassDB::bind_method(D_METHOD("push_lost_packet"), &AudioStreamPlaybackOpus::push_lost_packet);
+	ClassDB::bind_method(D_METHOD("can_push_packet", "size"), &AudioStreamPlaybackOpus::can_push_packet);
+	ClassDB::bind_method(D_METHOD("get_queued_packet_count"), &AudioStreamPlaybackOpus::get_queued_packet_count);
+	ClassDB::bind_method(D_METHOD("get_underrun_count"), &AudioStreamPlaybackOpus::get_underrun_count);
+	ClassDB::bind_method(D_METHOD("get_playout_latency_ms"), &AudioStreamPlaybackOpus::get_playout_latency_ms);
+	ClassDB::bind_method(D_METHOD("clear_buffer"), &AudioStreamPlaybackOpus::clear_buffer);
+}
+
+// AudioStreamOpus //////////////////////////////////////////////////////////
+
+AudioStreamOpus::AudioStreamOpus() {
+	sampling_rate = GodotOpus::SAMPLE_RATE_48000;
+	channels = GodotOpus::CHANNELS_STEREO;
+	frame_duration = GodotOpus::FRAMESIZE_20_MS;
+	buffer_length_seconds = 0.5;
+	max_concealed_frames = 5;
+	target_latency_ms = 0;
+}
+
+Ref<AudioStreamPlayback> AudioStreamOpus::_instantiate_playback() const {
+	Ref<AudioStreamPlaybackOpus> playback;
+	playback.instantiate();
+	playback->stream = Ref<AudioStreamOpus>(const_cast<AudioStreamOpus *>(this));
+	playback->channels = channels;
+	playback->sampling_rate = (int)sampling_rate;
+	playback->frame_size = GodotOpus::calculate_frame_size((int)sampling_rate, frame_duration);
+	playback->max_concealed_frames = max_concealed_frames;
+	playback->drift.set_target_ms(target_latency_ms);
+
+	int err;
+	playback->decoder = opus_decoder_create((int)sampling_rate, (int)channels, &err);
+	ERR_FAIL_COND_V_MSG(err != OPUS_OK, Ref<AudioStreamPlayback>(), opus_strerror(err));
+
+	// Largest packet is 120 ms of audio
+	playback->decode_pcm.resize((int)sampling_rate * 120 / 1000 * (int)channels);
+	playback->packet_data.resize(PacketQueue::MAX_PACKET_SIZE);
+	playback->fec_data.resize(PacketQueue::MAX_PACKET_SIZE + 2);
+
+	// Assume worst case 1275 byte frames for buffer_length_seconds
+	float packets_per_second = (float)sampling_rate / playback->frame_size;
+	float target_buffer_size = packets_per_second * (1275 + 2) * buffer_length_seconds;
+	ERR_FAIL_COND_V(target_buffer_size <= 0 || target_buffer_size >= (1 << 27), Ref<AudioStreamPlayback>());
+	playback->packet_queue.resize((int)target_buffer_size);
+
+	return playback;
+}
+
+String AudioStreamOpus::_get_stream_name() const {
+	return "Opus";
+}
+
+double AudioStreamOpus::_get_length() const {
+	return 0.0;
+}
+
+bool AudioStreamOpus::_is_monophonic() const {
+	// Packets are pushed to a single playback
+	return true;
+}
+
+// Getters and Setters ////////////////////////////////////////////////////////
+// Changes are applied to playbacks instantiated afterwards.
+
+void AudioStreamOpus::set_sampling_rate(const GodotOpus::SampleRate p_sampling_rate) {
+	sampling_rate = p_sampling_rate;
+}
+
+GodotOpus::SampleRate AudioStreamOpus::get_sampling_rate() const {
+	return sampling_rate;
+}
+
+void AudioStreamOpus::set_channels(const GodotOpus::Channels p_channels) {
+	channels = p_channels;
+}
+
+GodotOpus::Channels AudioStreamOpus::get_channels() const {
+	return channels;
+}
+
+void AudioStreamOpus::set_frame_duration(const GodotOpus::FrameSizeDuration p_frame_duration) {
+	frame_duration = p_frame_duration;
+}
+
+GodotOpus::FrameSizeDuration AudioStreamOpus::get_frame_duration() const {
+	return frame_duration;
+}
+
+void AudioStreamOpus::set_buffer_length_seconds(const float p_buffer_length_seconds) {
+	buffer_length_seconds = p_buffer_length_seconds;
+}
+
+float AudioStreamOpus::get_buffer_length_seconds() const {
+	return buffer_length_seconds;
+}
+
+void AudioStreamOpus::set_max_concealed_frames(const int p_max_concealed_frames) {
+	ERR_FAIL_COND_MSG(p_max_concealed_frames < 0, "max_concealed_frames must not be negative");
+	max_concealed_frames = p_max_concealed_frames;
+}
+
+int AudioStreamOpus::get_max_concealed_frames() const {
+	return max_concealed_frames;
+}
+
+void AudioStreamOpus::set_target_latency_ms(const float p_target_latency_ms) {
+	ERR_FAIL_COND_MSG(p_target_latency_ms < 0 || p_target_latency_ms > 2000, "target_latency_ms outside valid range 0-2000");
+	target_latency_ms = p_target_latency_ms;
+}
+
+float AudioStreamOpus::get_target_latency_ms() const {
+	return target_latency_ms;
+}
+
+// Bind methods
+
+void AudioStreamOpus::_bind_methods() {
+	ClassDB::bind_method(D_METHOD("get_sampling_rate"), &AudioStreamOpus::get_sampling_rate);
+	ClassDB::bind_method(D_METHOD("set_sampling_rate", "p_sampling_rate"), &AudioStreamOpus::set_sampling_rate);
+	ClassDB::bind_method(D_METHOD("get_channels"), &AudioStreamOpus::get_channels);
+	ClassDB::bind_method(D_METHOD("set_channels", "p_channels"), &AudioStreamOpus::set_channels);
+	ClassDB::bind_method(D_METHOD("get_frame_duration"), &AudioStreamOpus::get_frame_duration);
+	ClassDB::bind_method(D_METHOD("set_frame_duration", "p_frame_duration"), &AudioStreamOpus::set_frame_duration);
+	ClassDB::bind_method(D_METHOD("get_buffer_length_seconds"), &AudioStreamOpus::get_buffer_length_seconds);
+	ClassDB::bind_method(D_METHOD("set_buffer_length_seconds", "p_buffer_length_seconds"), &AudioStreamOpus::set_buffer_length_seconds);
+	ClassDB::bind_method(D_METHOD("get_max_concealed_frames"), &AudioStreamOpus::get_max_concealed_frames);
+	ClassDB::bind_method(D_METHOD("set_max_concealed_frames", "p_max_concealed_frames"), &AudioStreamOpus::set_max_concealed_frames);
+	ClassDB::bind_method(D_METHOD("get_target_latency_ms"), &AudioStreamOpus::get_target_latency_ms);
+	ClassDB::bind_method(D_METHOD("set_target_latency_ms", "p_target_latency_ms"), &AudioStreamOpus::set_target_latency_ms);
+
+	ClassDB::add_property("AudioStreamOpus", PropertyInfo(Variant::INT, "sampling_rate", PROPERTY_HINT_ENUM, "8 kHz:8000,12 kHz:12000,16 kHz:16000,24 kHz:24000,48 kHz:48000"), "set_sampling_rate", "get_sampling_rate");
+	ClassDB::add_property("AudioStreamOpus", PropertyInfo(Variant::INT, "channels", PROPERTY_HINT_ENUM, "Mono:1,Stereo:2"), "set_channels", "get_channels");
+	ClassDB::add_property("AudioStreamOpus", PropertyInfo(Variant::INT, "frame_duration", PROPERTY_HINT_ENUM, "2.5 ms:5001,5 ms:5002,10 ms:5003,20 ms:5004,40 ms:5005,60 ms:5006,80 ms:5007,100 ms:5008,120 ms:5009"), "set_frame_duration", "get_frame_duration");
+	ClassDB::add_property("AudioStreamOpus", PropertyInfo(Variant::FLOAT, "buffer_length_seconds", PROPERTY_HINT_RANGE, "0.01,10,0.01,exp,suffix:s"), "set_buffer_length_seconds", "get_buffer_length_seconds");
+	ClassDB::add_property("AudioStreamOpus", PropertyInfo(Variant::INT, "max_concealed_frames", PROPERTY_HINT_RANGE, "0,50,1"), "set_max_concealed_frames", "get_max_concealed_frames");
+	ClassDB::add_property("AudioStreamOpus", PropertyInfo(Variant::FLOAT, "target_latency_ms", PROPERTY_HINT_RANGE, "0,2000,1,suffix:ms"), "set_target_latency_ms", "get_target_latency_ms");
+}
@@ -0,0 +1,127 @@
+#ifndef AUDIO_STREAM_OPUS_H
+#define AUDIO_STREAM_OPUS_H
+
+#include <opus.h>
+#include <godot_cpp/classes/audio_frame.hpp>
+#include <godot_cpp/classes/audio_stream.hpp>
+#include <godot_cpp/classes/audio_stream_playback_resampled.hpp>
+#include <godot_cpp/templates/local_vector.hpp>
+#include <godot_cpp/templates/safe_refcount.hpp>
+
+#include "audio_resampler.h"
+#include "godot_opus.h"
+#include "packet_queue.h"
+
+namespace godot {
+
+class AudioStreamOpus;
+
+// Decodes queued Opus packets on demand, inside the mixer callback. Packets are
+// pushed from the game thread with push_packet; if the queue underruns while
+// playing, missing frames are concealed (PLC) and then filled with silence.
+class AudioStreamPlaybackOpus : public AudioStreamPlaybackResampled {
+	GDCLASS(AudioStreamPlaybackOpus, AudioStreamPlaybackResampled)
+	friend class AudioStreamOpus;
+
+	Ref<AudioStreamOpus> stream;
+
+	OpusDecoder *decoder;
+	GodotOpus::Channels channels;
+	int sampling_rate;
+	int frame_size;
+	int max_concealed_frames;
+
+	// Game thread writes, audio thread reads. An empty packet marks a lost packet.
+	PacketQueue packet_queue;
+	SafeNumeric<uint32_t> queued_packets;
+	SafeNumeric<uint32_t> underruns;
+	SafeNumeric<uint32_t> playout_latency_usec;
+
+	// Audio thread only
+	LocalVector<uint8_t> packet_data;
+	LocalVector<uint8_t> fec_data;
+	LocalVector<float> decode_pcm;
+	int pcm_pos;
+	int pcm_len;
+	int concealed_frames;
+	int64_t mixed_samples;
+	bool active;
+
+	// Steers the playback rate so the queued audio stays near the target
+	// latency, following the sender's clock. Audio thread only.
+	DriftCompensator drift;
+	double rate_scale;
+
+	bool _decode_next();
+	int _decode_packet(const uint8_t *data, int length);
+
+protected:
+	static void _bind_methods();
+
+public:
+	AudioStreamPlaybackOpus();
+	~AudioStreamPlaybackOpus();
+
+	bool push_packet(const PackedByteArray &data);
+	bool push_lost_packet();
+	bool can_push_packet(const int size) const;
+	int get_queued_packet_count() const;
+	int get_underrun_count() const;
+	float get_playout_latency_ms() const;
+	void clear_buffer();
+
+	virtual void _start(double from_pos) override;
+	virtual void _stop() override;
+	virtual bool _is_playing() const override;
+	virtual int32_t _get_loop_count() const override;
+	virtual double _get_playback_position() const override;
+	virtual void _seek(double position) override;
+
+	virtual int32_t _mix_resampled(AudioFrame *dst_buffer, int32_t frame_count) override;
+	virtual double _get_stream_sampling_rate() const override;
+};
+
+// An AudioStream fed with encoded Opus packets, decoded natively by the mixer.
+class AudioStreamOpus : public AudioStream {
+	GDCLASS(AudioStreamOpus, AudioStream)
+
+	GodotOpus::SampleRate sampling_rate;
+	GodotOpus::Channels channels;
+	GodotOpus::FrameSizeDuration frame_duration;
+	float buffer_length_seconds;
+	int max_concealed_frames;
+	float target_latency_ms;
+
+protected:
+	static void _bind_methods();
+
+public:
+	AudioStreamOpus();
+
+	virtual Ref<AudioStreamPlayback> _instantiate_playback() const override;
+	virtual String _get_stream_name() const override;
+	virtual double _get_length() const override;
+	virtual bool _is_monophonic() const override;
+
+	void set_sampling_rate(const GodotOpus::SampleRate p_sampling_rate);
+	GodotOpus::SampleRate get_sampling_rate() const;
+
+	void set_channels(const GodotOpus::Channels p_channels);
+	GodotOpus::Channels get_channels() const;
+
+	void set_frame_duration(const GodotOpus::FrameSizeDuration p_frame_duration);
+	GodotOpus::FrameSizeDuration get_frame_duration() const;
+
+	void set_buffer_length_seconds(const float p_buffer_length_seconds);
+	float get_buffer_length_seconds() const;
+
+	void set_max_concealed_frames(const int p_max_concealed_frames);
+	int get_max_concealed_frames() const;
+
+	void set_target_latency_ms(const float p_target_latency_ms);
+	float get_target_latency_ms() const;
+};
+
+} //namespace godot
+
+#endif // AUDIO_STREAM_OPUS_H
@@ -0,0 +1,168 @@
+#include <math.h>
+#include <string.h>
+
+#include <godot_cpp/core/error_macros.hpp>
+#include <godot_cpp/core/math.hpp>
+
+#include "audio_kernels.h"
+#include "audio_time_stretch.h"
+
+using namespace godot;
+
+void AudioTimeStretch::setup(const int p_rate, const int p_channels) {
+	ERR_FAIL_COND_MSG(p_channels < 0 || p_rate <= 0, "Invalid time stretch configuration");
+	channels = p_channels;
+	if (!is_active()) {
+		return;
+	}
+
+	overlap = p_rate * OVERLAP_MS / 1000;
+	seek = overlap / 2;
+
+	// Between steps no more than 2 * seek + 1.25 * overlap frames are kept (see process())
+	stride = 2 * seek + 2 * overlap + BLOCK_FRAMES;
+	history.resize(stride * (channels > 1 ? channels + 1 : 1));
+
+	// Raised cosine, so the fade-in and fade-out always sum to one
+	window.resize(overlap);
+	for (int i = 0; i < overlap; i++) {
+		const double s = sin(Math_PI * 0.5 * (i + 0.5) / overlap);
+		window[i] = (float)(s * s);
+	}
+
+	reset();
+}
+
+void AudioTimeStretch::reset() {
+	history_frames = 0;
+	tail_pos = 0;
+	nominal = 0.0;
+}
+
+void AudioTimeStretch::set_speed(const double p_speed) {
+	speed = CLAMP(p_speed, MIN_SPEED, MAX_SPEED);
+	if (speed == 1.0) {
+		// After another speed the nominal position is off the continuation, by
+		// a fraction of a frame or up to seek; put it back on so the audio
+		// passes through unsearched again
+		nominal = tail_pos;
+	}
+}
+
+int AudioTimeStretch::get_max_output(const int p_input_frames) const {
+	if (!is_active()) {
+		return p_input_frames;
+	}
+	// Each step outputs overlap frames and moves the nominal position on by at
+	// least MIN_SPEED * overlap, through the new input and what was kept
+	const int kept = stride - BLOCK_FRAMES;
+	return ((int)((p_input_frames + kept) / (overlap * MIN_SPEED)) + 1) * overlap;
+}
+
+const float *AudioTimeStretch::_mono() const {
+	return history.ptr() + (channels > 1 ? channels * stride : 0);
+}
+
+int AudioTimeStretch::_find_segment(const int p_lo, const int p_hi) const {
+	// Normalized cross-correlation of the first half of each candidate with
+	// the continuation it will be faded into. Every other offset is tried,
+	// then the neighbours of the best one.
+	const float *mono = _mono();
+	const float *ref = mono + tail_pos;
+	const int length = overlap / 2;
+
+	int best = p_lo;
+	float best_score = -INFINITY;
+	for (int pass = 0; pass < 2; pass++) {
+		const int from = pass == 0 ? p_lo : MAX(p_lo, best - 1);
+		const int to = pass == 0 ? p_hi : MIN(p_hi, best + 1);
+		const int step = pass == 0 ? 2 : 1;
+		for (int c = from; c <= to; c += step) {
+			const float xc = AudioKernels::dot(mono + c, ref, length);
+			const float energy = AudioKernels::dot(mono + c, mono + c, length);
+			// Squared, keeping the sign, to avoid a square root per candidate
+			const float score = xc * fabsf(xc) / (energy + 1e-9f);
+			if (score > best_score) {
+				best_score = score;
+				best = c;
+			}
+		}
+	}
+	return best;
+}
+
+void AudioTimeStretch::_overlap_add(const int p_segment, float *p_dst) const {
+	const float *w = window.ptr();
+	for (int c = 0; c < channels; c++) {
+		const float *h = history.ptr() + c * stride;
+		const float *fade_out = h + tail_pos;
+		const float *fade_in = h + p_segment;
+		float *dst = p_dst + c;
+		for (int i = 0; i < overlap; i++) {
+			dst[i * channels] = fade_out[i] + (fade_in[i] - fade_out[i]) * w[i];
+		}
+	}
+}
+
+int AudioTimeStretch::process(const float *p_src, int p_frames, float *p_dst) {
+	ERR_FAIL_COND_V(!is_active(), 0);
+
+	int written = 0;
+	while (p_frames > 0) {
+		const int count = MIN(p_frames, BLOCK_FRAMES);
+		for (int c = 0; c < channels; c++) {
+			float *h = history.ptr() + c * stride + history_frames;
+			for (int i = 0; i < count; i++) {
+				h[i] = p_src[i * channels + c];
+			}
+		}
+		if (channels > 1) {
+			float *m = history.ptr() + channels * stride + history_frames;
+			const float scale = 1.0f / channels;
+			for (int i = 0; i < count; i++) {
+				float sum = 0.0f;
+				for (int c = 0; c < channels; c++) {
+					sum += p_src[i * channels + c];
+				}
+				m[i] = sum * scale;
+			}
+		}
+		history_frames += count;
+		p_src += count * channels;
+		p_frames -= count;
+
+		while (true) {
+			const int n = (int)lround(nominal);
+			const int lo = MAX(0, n - seek);
+			const int hi = n + seek;
+			if (hi + overlap > history_frames || tail_pos + overlap > history_frames) {
+				break;
+			}
+
+			// While the nominal position keeps up with the continuation
+			// (speed 1.0), it is the best match
+			const int segment = n == tail_pos ? tail_pos : _find_segment(lo, hi);
+			_overlap_add(segment, p_dst + written * channels);
+			written += overlap;
+
+			tail_pos = segment + overlap;
+			nominal += overlap * speed;
+
+			// Drop what neither the next continuation nor the next search
+			// window reaches back to
+			const int consumed = MIN(tail_pos, MAX(0, (int)lround(nominal) - seek));
+			if (consumed > 0) {
+				const int planes = channels > 1 ? channels + 1 : 1;
+				for (int c = 0; c < planes; c++) {
+					float *h = history.ptr() + c * stride;
+					memmove(h, h + consumed, sizeof(float) * (history_frames - consumed));
+				}
+				history_frames -= consumed;
+				tail_pos -= consumed;
+				nominal -= consumed;
+			}
+		}
+	}
+
+	return written;
+}
@@ -0,0 +1,75 @@
+#ifndef AUDIO_TIME_STRETCH_H
+#define AUDIO_TIME_STRETCH_H
+
+#include <godot_cpp/templates/local_vector.hpp>
+
+namespace godot {
+
+// Streaming time-scale modification of interleaved float audio with WSOLA
+// (waveform similarity overlap-add). Plays its input faster or slower without
+// changing the pitch: each output block crossfades the continuation of the
+// previous block into the input segment near the nominal read position whose
+// waveform matches it best. At speed 1.0 the matching segment is the
+// continuation itself, so the audio passes through unchanged.
+// Nothing is allocated after setup(), so process() is safe to call from the
+// audio thread.
+class AudioTimeStretch {
+public:
+	static constexpr double MIN_SPEED = 0.8;
+	static constexpr double MAX_SPEED = 1.25;
+	// Crossfade length; each step outputs this much audio
+	static constexpr int OVERLAP_MS = 10;
+	// process() works through its input this many frames at a time
+	static constexpr int BLOCK_FRAMES = 512;
+
+private:
+	int channels = 0;
+	int overlap = 0;
+	// Candidates are searched within seek frames either side of the nominal position
+	int seek = 0;
+	double speed = 1.0;
+
+	// Planar input history, plus a mono downmix plane for matching when there's
+	// more than one channel. stride frames per plane.
+	LocalVector<float> history;
+	int stride = 0;
+	int history_frames = 0;
+
+	// Start of the previous segment's continuation, which the next step fades
+	// out, and the nominal start of the next segment
+	int tail_pos = 0;
+	double nominal = 0.0;
+
+	// Fade-in window over the overlap; the fade-out is its complement
+	LocalVector<float> window;
+
+	const float *_mono() const;
+	int _find_segment(const int p_lo, const int p_hi) const;
+	void _overlap_add(const int p_segment, float *p_dst) const;
+
+public:
+	// Configures the stretcher for p_channels channels at p_rate and resets it.
+	// Zero channels leave it inactive.
+	void setup(const int p_rate, const int p_channels);
+	void reset();
+
+	// Output speed relative to the input, from MIN_SPEED to MAX_SPEED
+	void set_speed(const double p_speed);
+	double get_speed() const { return speed; }
+
+	bool is_active() const { return channels > 0; }
+
+	// Input frames held back, i.e. the delay the stretcher adds
+	int get_buffered_frames() const { return history_frames - tail_pos; }
+
+	// Upper bound on the frames process() can return for p_input_frames of input
+	int get_max_output(const int p_input_frames) const;
+
+	// Stretches p_frames interleaved frames from p_src into p_dst, which needs
+	// room for get_max_output(p_frames) frames. Returns the frames written.
+	int process(const float *p_src, int p_frames, float *p_dst);
+};
+
+} //namespace godot
+
+#endif // AUDIO_TIME_STRETCH_H
@@ -2,389 +2,220 @@
 #include <godot_cpp/core/class_db.hpp>
 
 #include "godot_opus.h"
+#include "opus_decoder_state.h"
+#include "opus_encoder_state.h"
 
 using namespace godot;
 
 GodotOpus::GodotOpus() {
-	// Constructor, assign defaults here
-	encoder = NULL;
-	decoder = NULL;
+	// Constructor, defaults are assigned by the states
+	encoder_state.instantiate();
+	decoder_state.instantiate();
+	encoder_state->set_signal_owner(this);
 
 	encoder_enabled = true;
-	encoder_initialized = false;
-	buffer_initialized = false;
 	decoder_enabled = true;
-	decoder_initialized = false;
-
-	sampling_rate = SAMPLE_RATE_48000;
-	channels = CHANNELS_STEREO;
-	application_mode = APPLICATION_MODE_VOIP;
-	frame_duration = FRAMESIZE_20_MS;
-	bandwidth = BANDWIDTH_AUTO;
-	max_bandwidth = BANDWIDTH_FULLBAND;
-
-	skip_samples = 312; // 48 kHz, VoIP encoder gives 312 skip samples for lookahead
-	decoded_samples = 0;
-	dropped_sampling_multiple = 120; // 48kHz * 2.5ms
-
-	max_payload_bytes = 1024;
-	max_frame_size = 48000 * 2;
-	buffer_length_seconds = 0.5;
-
-	bitrate_mode = BITRATE_VARIABLE_AUTO;
-	bitrate_bps = 120000; // Default bitrate for 48 kHz stereo
-	encoder_complexity = 10;
-	packet_loss_perc = 0;
-
-	_update_frame_size(); // frame_size = 960; // sampling_rate / (1000 / frame_duration) => 48000 / 50
 }
 
 GodotOpus::~GodotOpus() {
-	// Destructor
-	if (encoder != NULL) {
-		opus_encoder_destroy(encoder);
-		encoder = NULL;
-	}
-
-	if (decoder != NULL) {
-		opus_decoder_destroy(decoder);
-		decoder = NULL;
-	}
+	// Destructor; a script may still hold on to the encoder state
+	encoder_state->set_signal_owner(NULL);
 }
 
 bool GodotOpus::initialize() {
-	encoder_initialized = false;
-	decoder_initialized = false;
-
-	if (encoder != NULL) {
-		opus_encoder_destroy(encoder);
-		encoder = NULL;
-	}
-
-	if (decoder != NULL) {
-		opus_decoder_destroy(decoder);
-		decoder = NULL;
-	}
-
-	int err;
 	if (encoder_enabled) {
-		encoder = opus_encoder_create((int)sampling_rate, (int)channels, (int)application_mode, &err);
-
-		ERR_FAIL_COND_V_MSG(err != OPUS_OK, false, opus_strerror(err));
-
-		opus_encoder_ctl(encoder, OPUS_SET_BANDWIDTH((int)bandwidth));
-
-		opus_int32 max_bw;
-		if (max_bandwidth == Bandwidth::BANDWIDTH_AUTO) {
-			// Allow max_bandwidth to be set to auto, but in that case,
-			// fall back to fullband, let normal bandwidth handle changes
-			max_bw = OPUS_BANDWIDTH_FULLBAND;
-		} else {
-			max_bw = (opus_int32)max_bandwidth;
-		}
-		opus_encoder_ctl(encoder, OPUS_SET_MAX_BANDWIDTH(max_bw));
-		opus_encoder_ctl(encoder, OPUS_GET_LOOKAHEAD(&skip_samples));
-		opus_encoder_ctl(encoder, OPUS_SET_COMPLEXITY(encoder_complexity));
-		opus_encoder_ctl(encoder, OPUS_SET_PACKET_LOSS_PERC(packet_loss_perc));
-
-		opus_int32 use_vbr = bitrate_mode == BITRATE_CONSTANT ? 0 : 1;
-		opus_encoder_ctl(encoder, OPUS_SET_VBR(use_vbr));
-		// opus_encoder_ctl(encoder, OPUS_SET_VBR_CONSTRAINT(cvbr));
-
-		if (bitrate_mode == BITRATE_VARIABLE_AUTO || bitrate_mode == BITRATE_VARIABLE_BITRATE_MAX) {
-			opus_encoder_ctl(encoder, OPUS_SET_BITRATE(bitrate_mode));
-			opus_encoder_ctl(encoder, OPUS_GET_BITRATE(&bitrate_bps));
-		} else {
-			// manual or constant mode, use bps
-			opus_encoder_ctl(encoder, OPUS_SET_BITRATE(bitrate_bps));
+		if (!encoder_state->initialize()) {
+			return false;
 		}
-
-		// opus_encoder_ctl(encoder, OPUS_SET_INBAND_FEC(use_inbandfec));
-		// opus_encoder_ctl(encoder, OPUS_SET_FORCE_CHANNELS(forcechannels));
-		// opus_encoder_ctl(encoder, OPUS_SET_DTX(use_dtx));
-		// opus_encoder_ctl(encoder, OPUS_SET_LSB_DEPTH(16));
-		// opus_encoder_ctl(encoder, OPUS_SET_EXPERT_FRAME_DURATION(variable_duration));
-
-		encode_data.resize(max_payload_bytes);
-
-		_initialize_buffer();
-
-		encoder_initialized = true;
+		// The decoder drops the encoder's lookahead from the start of the stream
+		decoder_state->set_skip_samples(encoder_state->get_lookahead());
+	} else {
+		encoder_state->release();
 	}
 
 	if (decoder_enabled) {
-		decoder = opus_decoder_create((int)sampling_rate, (int)channels, &err);
-
-		ERR_FAIL_COND_V_MSG(err != OPUS_OK, false, opus_strerror(err));
-
-		// opus_decoder_ctl(decoder, OPUS_SET_COMPLEXITY(dec_complexity));
-
-		decoded_samples = 0;
-		decode_data.resize(max_frame_size);
-		decoder_initialized = true;
+		return decoder_state->initialize();
 	}
-
+	decoder_state->release();
 	return true;
 }
 
-void GodotOpus::_initialize_buffer() {
-	if (!buffer_initialized) {
-		float target_buffer_size = (int)sampling_rate * (int)channels * buffer_length_seconds;
-		ERR_FAIL_COND(target_buffer_size <= 0 || target_buffer_size >= (1 << 27));
-		encode_buffer.resize(nearest_shift((int)target_buffer_size));
-		buffer_initialized = true;
-	}
+Ref<OpusEncoderState> GodotOpus::get_encoder_state() const {
+	return encoder_state;
+}
 
-	clear_buffer();
+Ref<OpusDecoderState> GodotOpus::get_decoder_state() const {
+	return decoder_state;
 }
 
 void GodotOpus::clear_buffer() {
-	const int32_t data_left = encode_buffer.data_left();
-	encode_buffer.advance_read(data_left);
+	encoder_state->clear_buffer();
 }
 
 bool GodotOpus::can_push_buffer(const int num_samples) const {
-	ERR_FAIL_COND_V(!buffer_initialized, false);
-	return encode_buffer.space_left() >= (num_samples * (int)channels);
+	return encoder_state->can_push_buffer(num_samples);
 }
 
 bool GodotOpus::push_buffer(const PackedVector2Array data) {
-	ERR_FAIL_COND_V_MSG(!buffer_initialized, false, "GodotOpus encode buffer not initialized");
-	ERR_FAIL_COND_V_MSG(encode_buffer.space_left() < (data.size() * (int)channels), false, "GodotOpus encode buffer has insuffient space left");
-
-	bool success;
-	if (channels == CHANNELS_STEREO) {
-		// Interleave the two channels
-		for (int i = 0; i < data.size(); i++) {
-			success = encode_buffer.write(data[i][0]);
-			ERR_FAIL_COND_V_MSG(!success, false, "GodotOpus encode buffer failed to write");
-
-			success = encode_buffer.write(data[i][1]);
-			ERR_FAIL_COND_V_MSG(!success, false, "GodotOpus encode buffer failed to write");
-		}
-	} else {
-		// Average the two channels
-		for (int i = 0; i < data.size(); i++) {
-			success = encode_buffer.write((data[i][0] + data[i][1]) * 0.5);
-			ERR_FAIL_COND_V_MSG(!success, false, "GodotOpus encode buffer failed to write");
-		}
-	}
-
-	return true;
+	return encoder_state->push_buffer(data);
 }
 
 bool GodotOpus::push_buffer_raw(const PackedFloat32Array data) {
-	ERR_FAIL_COND_V_MSG(!buffer_initialized, false, "GodotOpus encode buffer not initialized");
-	ERR_FAIL_COND_V_MSG(encode_buffer.space_left() < data.size(), false, "GodotOpus encode buffer has insuffient space left");
-
-	int written;
-	written = encode_buffer.write(data.ptr(), data.size());
-
-	if (written != data.size()) {
-		WARN_PRINT("GodotOpus push_buffer_raw did not write all samples to encode_buffer");
-		return false;
-	}
-	return true;
+	return encoder_state->push_buffer_raw(data);
 }
 
 bool GodotOpus::has_encoded_packet() const {
-	ERR_FAIL_COND_V(!buffer_initialized, false);
-	return encode_buffer.data_left() >= frame_size * (int)channels;
+	return encoder_state->has_encoded_packet();
 }
 
 PackedByteArray GodotOpus::get_encoded_packet() {
-	ERR_FAIL_COND_V_MSG(!encoder_initialized, PackedByteArray(), "GodotOpus not initialized with encoder configured");
-	if (!has_encoded_packet()) {
-		return PackedByteArray();
-	}
-
-	PackedFloat32Array pcm;
-	pcm.resize(frame_size * (int)channels);
-	int len = encode_buffer.read(pcm.ptrw(), frame_size * (int)channels, false);
-
-	ERR_FAIL_COND_V_MSG(len != (frame_size * (int)channels), PackedByteArray(), "Failed to read frame samples from encode_buffer");
+	return encoder_state->get_encoded_packet();
+}
 
-	opus_int32 encoded_length = opus_encode_float(encoder, pcm.ptr(), frame_size, encode_data.ptrw(), max_payload_bytes);
+Array GodotOpus::get_encoded_packets(const int max_packets) {
+	return encoder_state->get_encoded_packets(max_packets);
+}
 
-	ERR_FAIL_COND_V_MSG(encoded_length < 0, PackedByteArray(), opus_strerror(encoded_length));
+PackedByteArray GodotOpus::pop_encoded_packet() {
+	return encoder_state->pop_encoded_packet();
+}
 
-	int num_encoded = opus_packet_get_samples_per_frame(encode_data.ptr(), (int)sampling_rate) * opus_packet_get_nb_frames(encode_data.ptr(), encoded_length);
+int GodotOpus::get_queued_packet_count() const {
+	return encoder_state->get_queued_packet_count();
+}
 
-	encode_buffer.advance_read(num_encoded * (int)channels);
+Array GodotOpus::split_packet(const PackedByteArray &packet) {
+	Array ret;
+	OpusRepacketizer *rp = opus_repacketizer_create();
+	ERR_FAIL_NULL_V_MSG(rp, ret, "Failed to create Opus repacketizer");
 
-	PackedByteArray ret;
-	ret.resize(encoded_length);
-	for (int i = 0; i < encoded_length; i++) {
-		ret[i] = encode_data[i];
+	int err = opus_repacketizer_cat(rp, packet.ptr(), packet.size());
+	if (err != OPUS_OK) {
+		opus_repacketizer_destroy(rp);
+		ERR_FAIL_V_MSG(ret, opus_strerror(err));
 	}
-	return ret;
-}
 
-PackedVector2Array GodotOpus::decode(const PackedByteArray data) {
-	ERR_FAIL_COND_V_MSG(!decoder_initialized, PackedVector2Array(), "GodotOpus not initialized with decoder configured");
-
-	opus_int32 output_samples = max_frame_size;
-	output_samples = opus_decode_float(decoder, data.ptr(), data.size(), decode_data.ptrw(), output_samples, 0);
-
-	ERR_FAIL_COND_V_MSG(output_samples < 0, PackedVector2Array(), opus_strerror(output_samples));
-	decoded_samples += output_samples;
-
-	PackedVector2Array ret;
-	if (decoded_samples < skip_samples) {
-		int remaining = decoded_samples + output_samples - skip_samples;
-
-		if (remaining > 0) {
-			ret.resize(remaining);
-			if (channels == CHANNELS_STEREO) {
-				// Interleaved stereo case
-				for (int i = 0; i < remaining; i++) {
-					int idx = i + skip_samples - decoded_samples;
-					ret[i] = Vector2(decode_data[idx * 2], decode_data[idx * 2 + 1]);
-				}
-			} else {
-				// Mono case
-				for (int i = 0; i < remaining; i++) {
-					int idx = i + skip_samples - decoded_samples;
-					ret[i] = Vector2(decode_data[idx], decode_data[idx]);
-				}
-			}
-		}
-	} else {
-		ret.resize(output_samples);
-		if (channels == CHANNELS_STEREO) {
-			// Interleaved stereo case
-			for (int i = 0; i < output_samples; i++) {
-				ret[i] = Vector2(decode_data[i * 2], decode_data[i * 2 + 1]);
-			}
-		} else {
-			// Mono case
-			for (int i = 0; i < output_samples; i++) {
-				ret[i] = Vector2(decode_data[i], decode_data[i]);
-			}
+	// A single frame packet is never larger than the packet it came from
+	const int frames = opus_repacketizer_get_nb_frames(rp);
+	for (int i = 0; i < frames; i++) {
+		PackedByteArray frame;
+		frame.resize(packet.size());
+		opus_int32 length = opus_repacketizer_out_range(rp, i, i + 1, frame.ptrw(), frame.size());
+		if (length < 0) {
+			opus_repacketizer_destroy(rp);
+			ERR_FAIL_V_MSG(Array(), opus_strerror(length));
 		}
+		frame.resize(length);
+		ret.push_back(frame);
 	}
-	decoded_samples += output_samples;
 
+	opus_repacketizer_destroy(rp);
 	return ret;
 }
 
-PackedFloat32Array GodotOpus::decode_raw(const PackedByteArray data) {
-	ERR_FAIL_COND_V_MSG(!decoder_initialized, PackedFloat32Array(), "GodotOpus not initialized with decoder configured");
+bool GodotOpus::is_dtx_packet(const PackedByteArray &packet) {
+	// A DTX frame carries only its TOC byte (plus a frame count byte when
+	// repacketized); anything larger has actual audio to decode
+	return packet.size() > 0 && packet.size() <= 2;
+}
 
-	opus_int32 output_samples = max_frame_size;
-	output_samples = opus_decode_float(decoder, data.ptr(), data.size(), decode_data.ptrw(), output_samples, 0);
+bool GodotOpus::is_in_dtx() const {
+	return encoder_state->is_in_dtx();
+}
 
-	ERR_FAIL_COND_V_MSG(output_samples < 0, PackedFloat32Array(), opus_strerror(output_samples));
+PackedVector2Array GodotOpus::decode(const PackedByteArray data) {
+	return decoder_state->decode(data);
+}
 
-	PackedFloat32Array ret;
-	if (decoded_samples < skip_samples) {
-		int remaining = decoded_samples + output_samples - skip_samples;
-		if (remaining > 0) {
-			ret.resize(remaining);
-			for (int i = 0; i < remaining; i++) {
-				ret[i] = decode_data[i + skip_samples - decoded_samples];
-			}
-		}
-	} else {
-		ret.resize(output_samples);
-		for (int i = 0; i < output_samples; i++) {
-			ret[i] = decode_data[i];
-		}
-	}
-	decoded_samples += output_samples;
+PackedFloat32Array GodotOpus::decode_raw(const PackedByteArray data) {
+	return decoder_state->decode_raw(data);
+}
 
-	return ret;
+PackedFloat32Array GodotOpus::decode_mono(const PackedByteArray data) {
+	return decoder_state->decode_mono(data);
 }
 
 PackedVector2Array GodotOpus::decode_dropped(const int dropped_samples) {
-	ERR_FAIL_COND_V_MSG(!decoder_initialized, PackedVector2Array(), "GodotOpus not initialized with decoder configured");
+	return decoder_state->decode_dropped(dropped_samples);
+}
 
-	opus_int32 output_samples = _dropped_frame_size(dropped_samples);
-	output_samples = opus_decode_float(decoder, NULL, 0, decode_data.ptrw(), output_samples, 0);
+PackedFloat32Array GodotOpus::decode_dropped_raw(const int dropped_samples) {
+	return decoder_state->decode_dropped_raw(dropped_samples);
+}
 
-	ERR_FAIL_COND_V_MSG(output_samples < 0, PackedVector2Array(), opus_strerror(output_samples));
+PackedVector2Array GodotOpus::decode_with_fec(const PackedByteArray next_packet, const int lost_samples) {
+	return decoder_state->decode_with_fec(next_packet, lost_samples);
+}
 
-	PackedVector2Array ret;
-	ret.resize(output_samples);
-	if (channels == CHANNELS_STEREO) {
-		// Interleaved stereo case
-		for (int i = 0; i < output_samples; i++) {
-			ret[i] = Vector2(decode_data[i * 2], decode_data[i * 2 + 1]);
-		}
-	} else {
-		// Mono case
-		for (int i = 0; i < output_samples; i++) {
-			ret[i] = Vector2(decode_data[i], decode_data[i]);
-		}
-	}
-	return ret;
+PackedFloat32Array GodotOpus::decode_with_fec_raw(const PackedByteArray next_packet, const int lost_samples) {
+	return decoder_state->decode_with_fec_raw(next_packet, lost_samples);
 }
 
-PackedFloat32Array GodotOpus::decode_dropped_raw(const int dropped_samples) {
-	ERR_FAIL_COND_V_MSG(!decoder_initialized, PackedFloat32Array(), "GodotOpus not initialized with decoder configured");
+PackedVector2Array GodotOpus::decode_with_dred(const PackedByteArray next_packet, const int lost_samples) {
+	return decoder_state->decode_with_dred(next_packet, lost_samples);
+}
 
-	opus_int32 output_samples = _dropped_frame_size(dropped_samples);
-	output_samples = opus_decode_float(decoder, NULL, 0, decode_data.ptrw(), output_samples, 0);
+PackedFloat32Array GodotOpus::decode_with_dred_raw(const PackedByteArray next_packet, const int lost_samples) {
+	return decoder_state->decode_with_dred_raw(next_packet, lost_samples);
+}
 
-	ERR_FAIL_COND_V_MSG(output_samples < 0, PackedFloat32Array(), opus_strerror(output_samples));
+bool GodotOpus::is_dred_available() const {
+	return decoder_state->is_dred_available();
+}
 
-	PackedFloat32Array ret;
-	ret.resize(output_samples);
-	for (int i = 0; i < output_samples; i++) {
-		ret[i] = decode_data[i];
-	}
+bool GodotOpus::load_dnn_blob(const PackedByteArray &blob) {
+	ERR_FAIL_COND_V_MSG(blob.is_empty(), false, "DNN blob is empty");
+	// Both states share the one copy of the weights
+	const bool encoder_loaded = encoder_state->load_dnn_blob(blob);
+	const bool decoder_loaded = decoder_state->load_dnn_blob(blob);
+	return encoder_loaded && decoder_loaded;
+}
 
-	return ret;
+void GodotOpus::update_playout_latency(const int buffered_frames) {
+	decoder_state->update_playout_latency(buffered_frames);
 }
 
-int GodotOpus::reset_decoder_count() {
-	// Can overflow, but shouldn't matter.
-	int count = decoded_samples;
-	decoded_samples = 0;
-	return count;
+Dictionary GodotOpus::get_decoder_stats() const {
+	return decoder_state->get_decoder_stats();
 }
 
-int GodotOpus::get_decoder_count() const {
-	// Can overflow; matches what reset does.
-	int count = decoded_samples;
-	return count;
+void GodotOpus::reset_decoder_stats() {
+	decoder_state->reset_decoder_stats();
 }
 
-// Protected internal methods ///////////////////////////////////////////////
+int GodotOpus::reset_decoder_count() {
+	return decoder_state->reset_decoder_count();
+}
 
-int GodotOpus::_dropped_frame_size(const int samples) const {
-	if (samples % dropped_sampling_multiple == 0) {
-		return samples;
-	}
-	return samples - (samples % dropped_sampling_multiple) + dropped_sampling_multiple;
+int GodotOpus::get_decoder_count() const {
+	return decoder_state->get_decoder_count();
 }
 
-void GodotOpus::_update_frame_size() {
+int GodotOpus::calculate_frame_size(const int p_sampling_rate, const GodotOpus::FrameSizeDuration p_frame_duration) {
 	// frame_size is number of samples in a frame;
 	//  = sampling_rate / (1000 / frame_duration)
-	int sr = sampling_rate;
-	if (frame_duration == FRAMESIZE_2_5_MS) {
-		frame_size = sr / 400;
-	} else if (frame_duration == FRAMESIZE_5_MS) {
-		frame_size = sr / 200;
-	} else if (frame_duration == FRAMESIZE_10_MS) {
-		frame_size = sr / 100;
-	} else if (frame_duration == FRAMESIZE_20_MS) {
-		frame_size = sr / 50;
-	} else if (frame_duration == FRAMESIZE_40_MS) {
-		frame_size = sr / 25;
-	} else if (frame_duration == FRAMESIZE_60_MS) {
-		frame_size = 3 * sr / 50;
-	} else if (frame_duration == FRAMESIZE_80_MS) {
-		frame_size = 4 * sr / 50;
-	} else if (frame_duration == FRAMESIZE_100_MS) {
-		frame_size = 5 * sr / 50;
-	} else if (frame_duration == FRAMESIZE_120_MS) {
-		frame_size = 6 * sr / 50;
-	} else {
-		// Default of 20 ms
-		frame_size = sr / 50;
+	int sr = p_sampling_rate;
+	if (p_frame_duration == FRAMESIZE_2_5_MS) {
+		return sr / 400;
+	} else if (p_frame_duration == FRAMESIZE_5_MS) {
+		return sr / 200;
+	} else if (p_frame_duration == FRAMESIZE_10_MS) {
+		return sr / 100;
+	} else if (p_frame_duration == FRAMESIZE_20_MS) {
+		return sr / 50;
+	} else if (p_frame_duration == FRAMESIZE_40_MS) {
+		return sr / 25;
+	} else if (p_frame_duration == FRAMESIZE_60_MS) {
+		return 3 * sr / 50;
+	} else if (p_frame_duration == FRAMESIZE_80_MS) {
+		return 4 * sr / 50;
+	} else if (p_frame_duration == FRAMESIZE_100_MS) {
+		return 5 * sr / 50;
+	} else if (p_frame_duration == FRAMESIZE_120_MS) {
+		return 6 * sr / 50;
 	}
+	// Default of 20 ms
+	return sr / 50;
 }
 
 // Getters and Setters ////////////////////////////////////////////////////////
@@ -393,11 +224,11 @@ void GodotOpus::set_skip_samples(const int p_skip_samples) {
 	if (encoder_enabled) {
 		WARN_PRINT("Manually setting skip_samples when encoder_enabled");
 	}
-	skip_samples = p_skip_samples;
+	decoder_state->set_skip_samples(p_skip_samples);
 }
 
 int GodotOpus::get_skip_samples() const {
-	return skip_samples;
+	return decoder_state->get_skip_samples();
 }
 
 void GodotOpus::set_encoder_enabled(const bool p_encoder_enabled) {
@@ -417,134 +248,189 @@ bool GodotOpus::is_decoder_enabled() const {
 }
 
 void GodotOpus::set_sampling_rate(const GodotOpus::SampleRate p_sampling_rate) {
-	sampling_rate = p_sampling_rate;
-	dropped_sampling_multiple = (int)sampling_rate / 400;
-	_update_frame_size();
+	encoder_state->set_sampling_rate(p_sampling_rate);
+	decoder_state->set_sampling_rate(p_sampling_rate);
 }
 
 GodotOpus::SampleRate GodotOpus::get_sampling_rate() const {
-	return sampling_rate;
+	return encoder_state->get_sampling_rate();
 }
 
 void GodotOpus::set_channels(const GodotOpus::Channels p_channels) {
-	channels = p_channels;
+	encoder_state->set_channels(p_channels);
+	decoder_state->set_channels(p_channels);
 }
 
 GodotOpus::Channels GodotOpus::get_channels() const {
-	return channels;
+	return encoder_state->get_channels();
 }
 
 void GodotOpus::set_application_mode(const GodotOpus::ApplicationMode p_application_mode) {
-	application_mode = p_application_mode;
+	encoder_state->set_application_mode(p_application_mode);
 }
 
 GodotOpus::ApplicationMode GodotOpus::get_application_mode() const {
-	return application_mode;
+	return encoder_state->get_application_mode();
 }
 
 void GodotOpus::set_max_payload_bytes(const int p_max_payload_bytes) {
-	max_payload_bytes = p_max_payload_bytes;
+	encoder_state->set_max_payload_bytes(p_max_payload_bytes);
 }
 
 int GodotOpus::get_max_payload_bytes() const {
-	return max_payload_bytes;
+	return encoder_state->get_max_payload_bytes();
 }
 
 void GodotOpus::set_buffer_length_seconds(const float p_buffer_length_seconds) {
-	buffer_length_seconds = p_buffer_length_seconds;
+	encoder_state->set_buffer_length_seconds(p_buffer_length_seconds);
 }
 
 float GodotOpus::get_buffer_length_seconds() const {
-	return buffer_length_seconds;
+	return encoder_state->get_buffer_length_seconds();
 }
 
 void GodotOpus::set_frame_duration(const GodotOpus::FrameSizeDuration p_frame_duration) {
-	frame_duration = p_frame_duration;
-	_update_frame_size();
+	encoder_state->set_frame_duration(p_frame_duration);
+	decoder_state->set_frame_duration(p_frame_duration);
 }
 
 int GodotOpus::get_frame_size() const {
-	return frame_size;
+	return encoder_state->get_frame_size();
 }
 
 GodotOpus::FrameSizeDuration GodotOpus::get_frame_duration() const {
-	return frame_duration;
+	return encoder_state->get_frame_duration();
 }
 
 void GodotOpus::set_bandwidth(const GodotOpus::Bandwidth p_bandwidth) {
-	bandwidth = p_bandwidth;
+	encoder_state->set_bandwidth(p_bandwidth);
 }
 
 GodotOpus::Bandwidth GodotOpus::get_bandwidth() const {
-	return bandwidth;
+	return encoder_state->get_bandwidth();
 }
 
 void GodotOpus::set_max_bandwidth(const GodotOpus::Bandwidth p_bandwidth) {
-	max_bandwidth = p_bandwidth;
+	encoder_state->set_max_bandwidth(p_bandwidth);
 }
 
 GodotOpus::Bandwidth GodotOpus::get_max_bandwidth() const {
-	return max_bandwidth;
+	return encoder_state->get_max_bandwidth();
 }
 
 void GodotOpus::set_encoder_complexity(const int p_complexity) {
-	encoder_complexity = p_complexity;
+	encoder_state->set_encoder_complexity(p_complexity);
 }
 
 int GodotOpus::get_encoder_complexity() const {
-	return encoder_complexity;
+	return encoder_state->get_encoder_complexity();
+}
+
+void GodotOpus::set_async_encoding(const bool p_async_encoding) {
+	encoder_state->set_async_encoding(p_async_encoding);
+}
+
+bool GodotOpus::is_async_encoding() const {
+	return encoder_state->is_async_encoding();
+}
+
+void GodotOpus::set_frames_per_packet(const int p_frames_per_packet) {
+	encoder_state->set_frames_per_packet(p_frames_per_packet);
+}
+
+int GodotOpus::get_frames_per_packet() const {
+	return encoder_state->get_frames_per_packet();
+}
+
+void GodotOpus::set_mix_rate(const int p_mix_rate) {
+	encoder_state->set_mix_rate(p_mix_rate);
+	decoder_state->set_mix_rate(p_mix_rate);
+}
+
+int GodotOpus::get_mix_rate() const {
+	return encoder_state->get_mix_rate();
+}
+
+void GodotOpus::set_target_latency_ms(const float p_target_latency_ms) {
+	decoder_state->set_target_latency_ms(p_target_latency_ms);
+}
+
+float GodotOpus::get_target_latency_ms() const {
+	return decoder_state->get_target_latency_ms();
+}
+
+void GodotOpus::set_time_stretch(const bool p_time_stretch) {
+	decoder_state->set_time_stretch(p_time_stretch);
+}
+
+bool GodotOpus::is_time_stretch() const {
+	return decoder_state->is_time_stretch();
 }
 
 // Dynamic properties (don't require re-initialize() to be applied)
 
 void GodotOpus::set_bitrate_mode(const GodotOpus::BitrateMode p_mode) {
-	bitrate_mode = p_mode;
-
-	if (encoder_initialized) {
-		opus_int32 use_vbr = bitrate_mode == BITRATE_CONSTANT ? 0 : 1;
-		opus_encoder_ctl(encoder, OPUS_SET_VBR(use_vbr));
-
-		if (bitrate_mode == BITRATE_VARIABLE_AUTO || bitrate_mode == BITRATE_VARIABLE_BITRATE_MAX) {
-			opus_encoder_ctl(encoder, OPUS_SET_BITRATE(bitrate_mode));
-			opus_encoder_ctl(encoder, OPUS_GET_BITRATE(&bitrate_bps));
-		} else {
-			// manual or constant mode, use bps
-			opus_encoder_ctl(encoder, OPUS_SET_BITRATE(bitrate_bps));
-		}
-	}
+	encoder_state->set_bitrate_mode(p_mode);
 }
 
 GodotOpus::BitrateMode GodotOpus::get_bitrate_mode() const {
-	return bitrate_mode;
+	return encoder_state->get_bitrate_mode();
 }
 
 void GodotOpus::set_bitrate(const int p_bitrate) {
-	bitrate_bps = p_bitrate;
-
-	if (encoder_initialized) {
-		if (bitrate_mode == BITRATE_VARIABLE_AUTO || bitrate_mode == BITRATE_VARIABLE_BITRATE_MAX) {
-			WARN_PRINT_ONCE_ED("Bitrate value ignored when Bitrate Mode is Auto or Max");
-			opus_encoder_ctl(encoder, OPUS_GET_BITRATE(&bitrate_bps));
-		} else {
-			// manual or constant mode, use bps
-			bitrate_bps = p_bitrate;
-			opus_encoder_ctl(encoder, OPUS_SET_BITRATE(bitrate_bps));
-		}
-	}
+	encoder_state->set_bitrate(p_bitrate);
 }
 
 int GodotOpus::get_bitrate() const {
-	return bitrate_bps;
+	return encoder_state->get_bitrate();
 }
 
 void GodotOpus::set_packet_loss_perc(const int p_packet_loss_perc) {
-	ERR_FAIL_COND_MSG(p_packet_loss_perc < 0 || p_packet_loss_perc > 100, "packet_loss outside valid range 0-100");
-	packet_loss_perc = p_packet_loss_perc;
-	opus_encoder_ctl(encoder, OPUS_SET_PACKET_LOSS_PERC(packet_loss_perc));
+	encoder_state->set_packet_loss_perc(p_packet_loss_perc);
 }
 
 int GodotOpus::get_packet_loss_perc() const {
-	return packet_loss_perc;
+	return encoder_state->get_packet_loss_perc();
+}
+
+void GodotOpus::set_inband_fec(const bool p_inband_fec) {
+	encoder_state->set_inband_fec(p_inband_fec);
+}
+
+bool GodotOpus::is_inband_fec() const {
+	return encoder_state->is_inband_fec();
+}
+
+void GodotOpus::set_dtx(const bool p_dtx) {
+	encoder_state->set_dtx(p_dtx);
+}
+
+bool GodotOpus::is_dtx() const {
+	return encoder_state->is_dtx();
+}
+
+void GodotOpus::set_dred_duration_ms(const int p_dred_duration_ms) {
+	encoder_state->set_dred_duration_ms(p_dred_duration_ms);
+}
+
+int GodotOpus::get_dred_duration_ms() const {
+	return encoder_state->get_dred_duration_ms();
+}
+
+void GodotOpus::set_playout_speed(const float p_playout_speed) {
+	decoder_state->set_playout_speed(p_playout_speed);
+}
+
+float GodotOpus::get_playout_speed() const {
+	return decoder_state->get_playout_speed();
+}
+
+void GodotOpus::set_decoder_complexity(const int p_complexity) {
+	decoder_state->set_decoder_complexity(p_complexity);
+}
+
+int GodotOpus::get_decoder_complexity() const {
+	return decoder_state->get_decoder_complexity();
 }
 
 // Bind methods
@@ -552,6 +438,8 @@ int GodotOpus::get_packet_loss_perc() const {
 void GodotOpus::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("initialize"), &GodotOpus::initialize);
 	ClassDB::bind_method(D_METHOD("get_frame_size"), &GodotOpus::get_frame_size);
+	ClassDB::bind_method(D_METHOD("get_encoder_state"), &GodotOpus::get_encoder_state);
+	ClassDB::bind_method(D_METHOD("get_decoder_state"), &GodotOpus::get_decoder_state);
 
 	ClassDB::bind_method(D_METHOD("clear_buffer"), &GodotOpus::clear_buffer);
 	ClassDB::bind_method(D_METHOD("can_push_buffer", "num_samples"), &GodotOpus::can_push_buffer);
@@ -559,11 +447,27 @@ void GodotOpus::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("push_buffer_raw", "data"), &GodotOpus::push_buffer_raw);
 	ClassDB::bind_method(D_METHOD("has_encoded_packet"), &GodotOpus::has_encoded_packet);
 	ClassDB::bind_method(D_METHOD("get_encoded_packet"), &GodotOpus::get_encoded_packet);
+	ClassDB::bind_method(D_METHOD("get_encoded_packets", "max_packets"), &GodotOpus::get_encoded_packets, DEFVAL(-1));
+	ClassDB::bind_method(D_METHOD("pop_encoded_packet"), &GodotOpus::pop_encoded_packet);
+	ClassDB::bind_method(D_METHOD("get_queued_packet_count"), &GodotOpus::get_queued_packet_count);
 
+	ClassDB::bind_static_method("GodotOpus", D_METHOD("split_packet", "packet"), &GodotOpus::split_packet);
+	ClassDB::bind_static_method("GodotOpus", D_METHOD("is_dtx_packet", "packet"), &GodotOpus::is_dtx_packet);
+	ClassDB::bind_method(D_METHOD("is_in_dtx"), &GodotOpus::is_in_dtx);
 	ClassDB::bind_method(D_METHOD("decode", "data"), &GodotOpus::decode);
 	ClassDB::bind_method(D_METHOD("decode_raw", "data"), &GodotOpus::decode_raw);
+	ClassDB::bind_method(D_METHOD("decode_mono", "data"), &GodotOpus::decode_mono);
 	ClassDB::bind_method(D_METHOD("decode_dropped", "dropped_samples"), &GodotOpus::decode_dropped);
 	ClassDB::bind_method(D_METHOD("decode_dropped_raw", "dropped_samples"), &GodotOpus::decode_dropped_raw);
+	ClassDB::bind_method(D_METHOD("decode_with_fec", "next_packet", "lost_samples"), &GodotOpus::decode_with_fec);
+	ClassDB::bind_method(D_METHOD("decode_with_fec_raw", "next_packet", "lost_samples"), &GodotOpus::decode_with_fec_raw);
+	ClassDB::bind_method(D_METHOD("decode_with_dred", "next_packet", "lost_samples"), &GodotOpus::decode_with_dred);
+	ClassDB::bind_method(D_METHOD("decode_with_dred_raw", "next_packet", "lost_samples"), &GodotOpus::decode_with_dred_raw);
+	ClassDB::bind_method(D_METHOD("is_dred_available"), &GodotOpus::is_dred_available);
+	ClassDB::bind_method(D_METHOD("load_dnn_blob", "blob"), &GodotOpus::load_dnn_blob);
+	ClassDB::bind_method(D_METHOD("update_playout_latency", "buffered_frames"), &GodotOpus::update_playout_latency);
+	ClassDB::bind_method(D_METHOD("get_decoder_stats"), &GodotOpus::get_decoder_stats);
+	ClassDB::bind_method(D_METHOD("reset_decoder_stats"), &GodotOpus::reset_decoder_stats);
 
 	ClassDB::bind_method(D_METHOD("is_encoder_enabled"), &GodotOpus::is_encoder_enabled);
 	ClassDB::bind_method(D_METHOD("set_encoder_enabled", "p_encoder_enabled"), &GodotOpus::set_encoder_enabled);
@@ -596,8 +500,29 @@ void GodotOpus::_bind_methods() {
 
 	ClassDB::bind_method(D_METHOD("get_encoder_complexity"), &GodotOpus::get_encoder_complexity);
 	ClassDB::bind_method(D_METHOD("set_encoder_complexity", "p_complexity"), &GodotOpus::set_encoder_complexity);
+	ClassDB::bind_method(D_METHOD("get_decoder_complexity"), &GodotOpus::get_decoder_complexity);
+	ClassDB::bind_method(D_METHOD("set_decoder_complexity", "p_complexity"), &GodotOpus::set_decoder_complexity);
 	ClassDB::bind_method(D_METHOD("get_packet_loss_perc"), &GodotOpus::get_packet_loss_perc);
 	ClassDB::bind_method(D_METHOD("set_packet_loss_perc", "p_packet_loss"), &GodotOpus::set_packet_loss_perc);
+	ClassDB::bind_method(D_METHOD("is_inband_fec"), &GodotOpus::is_inband_fec);
+	ClassDB::bind_method(D_METHOD("set_inband_fec", "p_inband_fec"), &GodotOpus::set_inband_fec);
+	ClassDB::bind_method(D_METHOD("is_dtx"), &GodotOpus::is_dtx);
+	ClassDB::bind_method(D_METHOD("set_dtx", "p_dtx"), &GodotOpus::set_dtx);
+	ClassDB::bind_method(D_METHOD("get_dred_duration_ms"), &GodotOpus::get_dred_duration_ms);
+	ClassDB::bind_method(D_METHOD("set_dred_duration_ms", "p_dred_duration_ms"), &GodotOpus::set_dred_duration_ms);
+	ClassDB::bind_method(D_METHOD("get_playout_speed"), &GodotOpus::get_playout_speed);
+	ClassDB::bind_method(D_METHOD("set_playout_speed", "p_playout_speed"), &GodotOpus::set_playout_speed);
+
+	ClassDB::bind_method(D_METHOD("is_async_encoding"), &GodotOpus::is_async_encoding);
+	ClassDB::bind_method(D_METHOD("set_async_encoding", "p_async_encoding"), &GodotOpus::set_async_encoding);
+	ClassDB::bind_method(D_METHOD("get_frames_per_packet"), &GodotOpus::get_frames_per_packet);
+	ClassDB::bind_method(D_METHOD("set_frames_per_packet", "p_frames_per_packet"), &GodotOpus::set_frames_per_packet);
+	ClassDB::bind_method(D_METHOD("get_mix_rate"), &GodotOpus::get_mix_rate);
+	ClassDB::bind_method(D_METHOD("set_mix_rate", "p_mix_rate"), &GodotOpus::set_mix_rate);
+	ClassDB::bind_method(D_METHOD("get_target_latency_ms"), &GodotOpus::get_target_latency_ms);
+	ClassDB::bind_method(D_METHOD("set_target_latency_ms", "p_target_latency_ms"), &GodotOpus::set_target_latency_ms);
+	ClassDB::bind_method(D_METHOD("is_time_stretch"), &GodotOpus::is_time_stretch);
+	ClassDB::bind_method(D_METHOD("set_time_stretch", "p_time_stretch"), &GodotOpus::set_time_stretch);
 
 	ClassDB::bind_method(D_METHOD("get_max_payload_bytes"), &GodotOpus::get_max_payload_bytes);
 	ClassDB::bind_method(D_METHOD("set_max_payload_bytes", "p_max_payload_bytes"), &GodotOpus::set_max_payload_bytes);
@@ -615,9 +540,21 @@ void GodotOpus::_bind_methods() {
 	ClassDB::add_property("GodotOpus", PropertyInfo(Variant::INT, "bitrate_mode", PROPERTY_HINT_ENUM, "VBR Auto:-1000,VBR Max:-1,VBR Manual:0,CBR:1"), "set_bitrate_mode", "get_bitrate_mode");
 	ClassDB::add_property("GodotOpus", PropertyInfo(Variant::INT, "bitrate", PROPERTY_HINT_RANGE, "6000,512000,1000,exp,suffix:bps"), "set_bitrate", "get_bitrate");
 	ClassDB::add_property("GodotOpus", PropertyInfo(Variant::INT, "encoder_complexity", PROPERTY_HINT_RANGE, "0,10,1"), "set_encoder_complexity", "get_encoder_complexity");
+	ClassDB::add_property("GodotOpus", PropertyInfo(Variant::INT, "decoder_complexity", PROPERTY_HINT_RANGE, "0,10,1"), "set_decoder_complexity", "get_decoder_complexity");
 	ClassDB::add_property("GodotOpus", PropertyInfo(Variant::INT, "packet_loss", PROPERTY_HINT_RANGE, "0,100,1,suffix:%"), "set_packet_loss_perc", "get_packet_loss_perc");
+	ClassDB::add_property("GodotOpus", PropertyInfo(Variant::BOOL, "inband_fec"), "set_inband_fec", "is_inband_fec");
+	ClassDB::add_property("GodotOpus", PropertyInfo(Variant::BOOL, "dtx"), "set_dtx", "is_dtx");
+	ClassDB::add_property("GodotOpus", PropertyInfo(Variant::INT, "dred_duration", PROPERTY_HINT_RANGE, "0,1040,10,suffix:ms"), "set_dred_duration_ms", "get_dred_duration_ms");
+	ClassDB::add_property("GodotOpus", PropertyInfo(Variant::FLOAT, "playout_speed", PROPERTY_HINT_RANGE, "0.8,1.25,0.01"), "set_playout_speed", "get_playout_speed");
+	ClassDB::add_property("GodotOpus", PropertyInfo(Variant::INT, "frames_per_packet", PROPERTY_HINT_RANGE, "1,48,1"), "set_frames_per_packet", "get_frames_per_packet");
+	ClassDB::add_property("GodotOpus", PropertyInfo(Variant::INT, "mix_rate", PROPERTY_HINT_RANGE, "0,192000,1,suffix:Hz"), "set_mix_rate", "get_mix_rate");
+	ClassDB::add_property("GodotOpus", PropertyInfo(Variant::FLOAT, "target_latency_ms", PROPERTY_HINT_RANGE, "0,2000,1,suffix:ms"), "set_target_latency_ms", "get_target_latency_ms");
+	ClassDB::add_property("GodotOpus", PropertyInfo(Variant::BOOL, "time_stretch"), "set_time_stretch", "is_time_stretch");
 	ClassDB::add_property("GodotOpus", PropertyInfo(Variant::INT, "max_payload_bytes", PROPERTY_HINT_RANGE, "16,2048,16,suffix:B"), "set_max_payload_bytes", "get_max_payload_bytes");
 	ClassDB::add_property("GodotOpus", PropertyInfo(Variant::FLOAT, "buffer_length_seconds", PROPERTY_HINT_RANGE, "0.01,10,0.01,exp,suffix:s"), "set_buffer_length_seconds", "get_buffer_length_seconds");
+	ClassDB::add_property("GodotOpus", PropertyInfo(Variant::BOOL, "async_encoding"), "set_async_encoding", "is_async_encoding");
+
+	ADD_SIGNAL(MethodInfo("packet_encoded", PropertyInfo(Variant::PACKED_BYTE_ARRAY, "packet")));
 
 	BIND_ENUM_CONSTANT(SAMPLE_RATE_8000);
 	BIND_ENUM_CONSTANT(SAMPLE_RATE_12000);
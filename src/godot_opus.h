@@ -3,11 +3,13 @@
 
 #include <opus.h>
 #include <godot_cpp/classes/node.hpp>
-
-#include "ring_buffer.h"
+#include <godot_cpp/classes/ref.hpp>
 
 namespace godot {
 
+class OpusEncoderState;
+class OpusDecoderState;
+
 class GodotOpus : public Node {
 	GDCLASS(GodotOpus, Node)
 
@@ -60,49 +62,17 @@ public:
 	};
 
 private:
-	OpusEncoder *encoder;
-	OpusDecoder *decoder;
+	// The codec core, which also works without the node (see OpusEncoderState
+	// and OpusDecoderState). Properties shared by both are set on both.
+	Ref<OpusEncoderState> encoder_state;
+	Ref<OpusDecoderState> decoder_state;
 
 	bool encoder_enabled;
-	bool encoder_initialized;
-	bool buffer_initialized;
-
 	bool decoder_enabled;
-	bool decoder_initialized;
-
-	RingBuffer<float> encode_buffer;
-	PackedByteArray encode_data;
-	PackedFloat32Array decode_data;
-
-	int skip_samples;
-	int64_t decoded_samples;
-	int dropped_sampling_multiple;
-
-	SampleRate sampling_rate;
-	Channels channels;
-	ApplicationMode application_mode;
-	FrameSizeDuration frame_duration;
-	Bandwidth bandwidth;
-	Bandwidth max_bandwidth;
-
-	int max_payload_bytes;
-	int max_frame_size;
-	int frame_size;
-
-	BitrateMode bitrate_mode;
-	int bitrate_bps;
-	int encoder_complexity;
-	int packet_loss_perc;
-
-	float buffer_length_seconds;
 
 protected:
 	static void _bind_methods();
 
-	void _initialize_buffer();
-	int _dropped_frame_size(const int samples) const;
-	void _update_frame_size();
-
 public:
 	GodotOpus();
 	~GodotOpus();
@@ -111,6 +81,10 @@ public:
 
 	bool initialize();
 
+	// The states doing the work, e.g. to hand one to a thread
+	Ref<OpusEncoderState> get_encoder_state() const;
+	Ref<OpusDecoderState> get_decoder_state() const;
+
 	void clear_buffer();
 
 	// Push onto encode buffer (queue)
@@ -121,15 +95,55 @@ public:
 	// Pop and encode packets from encode buffer
 	bool has_encoded_packet() const;
 	PackedByteArray get_encoded_packet();
+	Array get_encoded_packets(const int max_packets = -1);
+
+	// Pop packets encoded in the background (async_encoding)
+	PackedByteArray pop_encoded_packet();
+	int get_queued_packet_count() const;
+
+	// Split a packet holding several frames into single frame packets
+	static Array split_packet(const PackedByteArray &packet);
+
+	// With dtx enabled, silent frames are encoded as 1-2 byte packets that don't
+	// need to be sent; the receiver decodes the gap with decode_dropped.
+	static bool is_dtx_packet(const PackedByteArray &packet);
+	bool is_in_dtx() const;
 
 	// Decode an encoded packet
 	PackedVector2Array decode(const PackedByteArray data);
 	PackedFloat32Array decode_raw(const PackedByteArray data);
+	// One sample per frame, e.g. for positional voice, downmixed if the stream is stereo
+	PackedFloat32Array decode_mono(const PackedByteArray data);
 
 	// Decode (and inform decoder of) dropped packet, in terms of sample length of the packet
 	PackedVector2Array decode_dropped(const int dropped_samples);
 	PackedFloat32Array decode_dropped_raw(const int dropped_samples);
 
+	// Recover a dropped packet from the in-band FEC data of the packet after it.
+	// Falls back to concealment if next_packet has no FEC data. Decode next_packet
+	// normally afterwards.
+	PackedVector2Array decode_with_fec(const PackedByteArray next_packet, const int lost_samples);
+	PackedFloat32Array decode_with_fec_raw(const PackedByteArray next_packet, const int lost_samples);
+
+	// Rebuild a burst of lost audio (up to about a second) from the Deep REDundancy
+	// data in the first packet after it, using FEC or concealment for any part it
+	// doesn't cover. Decode next_packet normally afterwards.
+	PackedVector2Array decode_with_dred(const PackedByteArray next_packet, const int lost_samples);
+	PackedFloat32Array decode_with_dred_raw(const PackedByteArray next_packet, const int lost_samples);
+	bool is_dred_available() const;
+
+	// Replace the DNN weights with a blob (as written by write_lpcnet_weights)
+	bool load_dnn_blob(const PackedByteArray &blob);
+
+	// Reports the decoded frames still queued for playout (e.g. in an
+	// AudioStreamGenerator), adjusting the decode resampling toward target_latency_ms,
+	// and the playout_speed when time_stretch is enabled
+	void update_playout_latency(const int buffered_frames);
+
+	// CPU time spent decoding, to weigh decoder_complexity against
+	Dictionary get_decoder_stats() const;
+	void reset_decoder_stats();
+
 	// Resets the decoded samples count, reinitiating the skipped frames. Returns decoded samples before reset.
 	int reset_decoder_count();
 	int get_decoder_count() const;
@@ -169,6 +183,24 @@ public:
 	void set_encoder_complexity(const int p_complexity);
 	int get_encoder_complexity() const;
 
+	void set_decoder_complexity(const int p_complexity);
+	int get_decoder_complexity() const;
+
+	void set_async_encoding(const bool p_async_encoding);
+	bool is_async_encoding() const;
+
+	void set_frames_per_packet(const int p_frames_per_packet);
+	int get_frames_per_packet() const;
+
+	void set_mix_rate(const int p_mix_rate);
+	int get_mix_rate() const;
+
+	void set_target_latency_ms(const float p_target_latency_ms);
+	float get_target_latency_ms() const;
+
+	void set_time_stretch(const bool p_time_stretch);
+	bool is_time_stretch() const;
+
 	// Dynamic properties
 
 	void set_bitrate_mode(const GodotOpus::BitrateMode p_mode);
@@ -180,9 +212,24 @@ public:
 	void set_packet_loss_perc(const int p_packet_loss_perc);
 	int get_packet_loss_perc() const;
 
+	void set_inband_fec(const bool p_inband_fec);
+	bool is_inband_fec() const;
+
+	void set_dtx(const bool p_dtx);
+	bool is_dtx() const;
+
+	void set_dred_duration_ms(const int p_dred_duration_ms);
+	int get_dred_duration_ms() const;
+
+	void set_playout_speed(const float p_playout_speed);
+	float get_playout_speed() const;
+
 	// Not exposed as a property
 	int get_frame_size() const;
 
+	// Number of samples (per channel) in a frame of the given duration
+	static int calculate_frame_size(const int p_sampling_rate, const GodotOpus::FrameSizeDuration p_frame_duration);
+
 	void set_skip_samples(const int p_skip_samples);
 	int get_skip_samples() const;
 };
@@ -0,0 +1,337 @@
+#include <string.h>
+
+#include <godot_cpp/core/class_db.hpp>
+
+#include "opus_ambisonics.h"
+
+using namespace godot;
+
+OpusAmbisonics::OpusAmbisonics() {
+	encoder = NULL;
+	decoder = NULL;
+
+	encoder_enabled = true;
+	decoder_enabled = true;
+
+	sampling_rate = GodotOpus::SAMPLE_RATE_48000;
+	ambisonic_order = 1;
+	non_diegetic_stereo = false;
+	application_mode = GodotOpus::APPLICATION_MODE_AUDIO;
+	frame_duration = GodotOpus::FRAMESIZE_20_MS;
+	bitrate_bps = OPUS_AUTO;
+	max_payload_bytes = 4000;
+	frame_size = 960;
+	channels = 4;
+	stream_order = 1;
+	stream_stereo = false;
+
+	streams = 0;
+	coupled_streams = 0;
+
+	_update_render_gains();
+}
+
+OpusAmbisonics::~OpusAmbisonics() {
+	_destroy();
+}
+
+void OpusAmbisonics::_destroy() {
+	if (encoder != NULL) {
+		opus_projection_encoder_destroy(encoder);
+		encoder = NULL;
+	}
+	if (decoder != NULL) {
+		opus_projection_decoder_destroy(decoder);
+		decoder = NULL;
+	}
+}
+
+void OpusAmbisonics::_update_render_gains() {
+	// Renders with a virtual in-phase microphone at each ear. The ear directions
+	// are taken from Godot space (-Z forward, +X right, +Y up) to the ambisonic
+	// frame (+X forward, +Y left, +Z up), and the real SN3D spherical harmonics
+	// are evaluated there, weighted per order so the pickup pattern is
+	// ((1 + cos) / 2)^order with no rear lobes.
+	static const float order_weights[3][3] = {
+		{ 1.0f, 0.0f, 0.0f },
+		{ 0.5f, 0.5f, 0.0f },
+		{ 1.0f / 3.0f, 0.5f, 1.0f / 6.0f },
+	};
+	const float *w = order_weights[stream_order];
+	const float sqrt3 = 1.7320508f;
+
+	for (int ear = 0; ear < 2; ear++) {
+		Vector3 dir = listener_basis.xform(Vector3(ear == 0 ? -1.0f : 1.0f, 0.0f, 0.0f)).normalized();
+		const float x = -dir.z;
+		const float y = -dir.x;
+		const float z = dir.y;
+
+		float *gains = ear == 0 ? render_left : render_right;
+		gains[0] = w[0];
+		gains[1] = w[1] * y;
+		gains[2] = w[1] * z;
+		gains[3] = w[1] * x;
+		gains[4] = w[2] * sqrt3 * x * y;
+		gains[5] = w[2] * sqrt3 * y * z;
+		gains[6] = w[2] * 0.5f * (3.0f * z * z - 1.0f);
+		gains[7] = w[2] * sqrt3 * x * z;
+		gains[8] = w[2] * 0.5f * sqrt3 * (x * x - y * y);
+	}
+}
+
+bool OpusAmbisonics::initialize() {
+	_destroy();
+
+	frame_size = GodotOpus::calculate_frame_size((int)sampling_rate, frame_duration);
+	stream_order = ambisonic_order;
+	stream_stereo = non_diegetic_stereo;
+	channels = (stream_order + 1) * (stream_order + 1) + (stream_stereo ? 2 : 0);
+	_update_render_gains();
+
+	// The decoder needs the encoder's demixing matrix. It only depends on the
+	// channel layout, so a receiving side builds it with a local encoder too.
+	int err;
+	OpusProjectionEncoder *layout_encoder = opus_projection_ambisonics_encoder_create((int)sampling_rate, channels, 3, &streams, &coupled_streams, (int)application_mode, &err);
+	ERR_FAIL_COND_V_MSG(err != OPUS_OK, false, opus_strerror(err));
+
+	if (decoder_enabled) {
+		opus_int32 matrix_size;
+		opus_projection_encoder_ctl(layout_encoder, OPUS_PROJECTION_GET_DEMIXING_MATRIX_SIZE(&matrix_size));
+		PackedByteArray matrix;
+		matrix.resize(matrix_size);
+		opus_projection_encoder_ctl(layout_encoder, OPUS_PROJECTION_GET_DEMIXING_MATRIX(matrix.ptrw(), matrix_size));
+
+		decoder = opus_projection_decoder_create((int)sampling_rate, channels, streams, coupled_streams, matrix.ptrw(), matrix_size, &err);
+		if (err != OPUS_OK) {
+			opus_projection_encoder_destroy(layout_encoder);
+			ERR_FAIL_V_MSG(false, opus_strerror(err));
+		}
+
+		// Largest packet is 120 ms of audio
+		decode_pcm.resize((int)sampling_rate * 120 / 1000 * channels);
+	}
+
+	if (encoder_enabled) {
+		encoder = layout_encoder;
+		if (bitrate_bps != OPUS_AUTO) {
+			opus_projection_encoder_ctl(encoder, OPUS_SET_BITRATE(bitrate_bps));
+		}
+		encode_data.resize(max_payload_bytes);
+	} else {
+		opus_projection_encoder_destroy(layout_encoder);
+	}
+
+	return true;
+}
+
+PackedByteArray OpusAmbisonics::encode(const PackedFloat32Array &pcm) {
+	ERR_FAIL_NULL_V_MSG(encoder, PackedByteArray(), "OpusAmbisonics not initialized with encoder configured");
+	ERR_FAIL_COND_V_MSG(pcm.size() != frame_size * channels, PackedByteArray(), "Encode expects exactly one frame of interleaved samples");
+
+	opus_int32 encoded_length = opus_projection_encode_float(encoder, pcm.ptr(), frame_size, encode_data.ptrw(), encode_data.size());
+	ERR_FAIL_COND_V_MSG(encoded_length < 0, PackedByteArray(), opus_strerror(encoded_length));
+
+	PackedByteArray ret;
+	ret.resize(encoded_length);
+	memcpy(ret.ptrw(), encode_data.ptr(), encoded_length);
+	return ret;
+}
+
+int OpusAmbisonics::_decode(const PackedByteArray &packet) {
+	// An empty packet is concealed as a lost frame
+	const int max_samples = decode_pcm.size() / channels;
+	int decoded;
+	if (packet.is_empty()) {
+		decoded = opus_projection_decode_float(decoder, NULL, 0, decode_pcm.ptrw(), frame_size, 0);
+	} else {
+		decoded = opus_projection_decode_float(decoder, packet.ptr(), packet.size(), decode_pcm.ptrw(), max_samples, 0);
+	}
+	ERR_FAIL_COND_V_MSG(decoded < 0, -1, opus_strerror(decoded));
+	return decoded;
+}
+
+PackedFloat32Array OpusAmbisonics::decode(const PackedByteArray &packet) {
+	ERR_FAIL_NULL_V_MSG(decoder, PackedFloat32Array(), "OpusAmbisonics not initialized with decoder configured");
+
+	int decoded = _decode(packet);
+	if (decoded < 0) {
+		return PackedFloat32Array();
+	}
+
+	PackedFloat32Array ret;
+	ret.resize(decoded * channels);
+	memcpy(ret.ptrw(), decode_pcm.ptr(), sizeof(float) * decoded * channels);
+	return ret;
+}
+
+PackedVector2Array OpusAmbisonics::decode_to_stereo(const PackedByteArray &packet) {
+	ERR_FAIL_NULL_V_MSG(decoder, PackedVector2Array(), "OpusAmbisonics not initialized with decoder configured");
+
+	int decoded = _decode(packet);
+	if (decoded < 0) {
+		return PackedVector2Array();
+	}
+
+	const int ambisonic_channels = (stream_order + 1) * (stream_order + 1);
+	const float *src = decode_pcm.ptr();
+
+	PackedVector2Array ret;
+	ret.resize(decoded);
+	Vector2 *dst = ret.ptrw();
+	for (int i = 0; i < decoded; i++) {
+		const float *frame = src + i * channels;
+		float left = 0.0f;
+		float right = 0.0f;
+		for (int c = 0; c < ambisonic_channels; c++) {
+			left += render_left[c] * frame[c];
+			right += render_right[c] * frame[c];
+		}
+		if (stream_stereo) {
+			// Head-locked channels go straight to the ears
+			left += frame[ambisonic_channels];
+			right += frame[ambisonic_channels + 1];
+		}
+		dst[i] = Vector2(left, right);
+	}
+	return ret;
+}
+
+int OpusAmbisonics::get_frame_size() const {
+	return frame_size;
+}
+
+int OpusAmbisonics::get_channel_count() const {
+	return channels;
+}
+
+// Getters and Setters ////////////////////////////////////////////////////////
+
+void OpusAmbisonics::set_listener_basis(const Basis &p_basis) {
+	listener_basis = p_basis;
+	_update_render_gains();
+}
+
+Basis OpusAmbisonics::get_listener_basis() const {
+	return listener_basis;
+}
+
+// The rest are applied on initialize().
+
+void OpusAmbisonics::set_encoder_enabled(const bool p_encoder_enabled) {
+	encoder_enabled = p_encoder_enabled;
+}
+
+bool OpusAmbisonics::is_encoder_enabled() const {
+	return encoder_enabled;
+}
+
+void OpusAmbisonics::set_decoder_enabled(const bool p_decoder_enabled) {
+	decoder_enabled = p_decoder_enabled;
+}
+
+bool OpusAmbisonics::is_decoder_enabled() const {
+	return decoder_enabled;
+}
+
+void OpusAmbisonics::set_sampling_rate(const GodotOpus::SampleRate p_sampling_rate) {
+	sampling_rate = p_sampling_rate;
+}
+
+GodotOpus::SampleRate OpusAmbisonics::get_sampling_rate() const {
+	return sampling_rate;
+}
+
+void OpusAmbisonics::set_ambisonic_order(const int p_order) {
+	ERR_FAIL_COND_MSG(p_order < 1 || p_order > 2, "OpusAmbisonics supports first and second order");
+	ambisonic_order = p_order;
+}
+
+int OpusAmbisonics::get_ambisonic_order() const {
+	return ambisonic_order;
+}
+
+void OpusAmbisonics::set_non_diegetic_stereo(const bool p_enabled) {
+	non_diegetic_stereo = p_enabled;
+}
+
+bool OpusAmbisonics::has_non_diegetic_stereo() const {
+	return non_diegetic_stereo;
+}
+
+void OpusAmbisonics::set_application_mode(const GodotOpus::ApplicationMode p_application_mode) {
+	application_mode = p_application_mode;
+}
+
+GodotOpus::ApplicationMode OpusAmbisonics::get_application_mode() const {
+	return application_mode;
+}
+
+void OpusAmbisonics::set_frame_duration(const GodotOpus::FrameSizeDuration p_frame_duration) {
+	frame_duration = p_frame_duration;
+}
+
+GodotOpus::FrameSizeDuration OpusAmbisonics::get_frame_duration() const {
+	return frame_duration;
+}
+
+void OpusAmbisonics::set_bitrate(const int p_bitrate) {
+	bitrate_bps = p_bitrate;
+	if (encoder != NULL) {
+		opus_projection_encoder_ctl(encoder, OPUS_SET_BITRATE(bitrate_bps));
+	}
+}
+
+int OpusAmbisonics::get_bitrate() const {
+	return bitrate_bps;
+}
+
+void OpusAmbisonics::set_max_payload_bytes(const int p_max_payload_bytes) {
+	max_payload_bytes = p_max_payload_bytes;
+}
+
+int OpusAmbisonics::get_max_payload_bytes() const {
+	return max_payload_bytes;
+}
+
+// Bind methods
+
+void OpusAmbisonics::_bind_methods() {
+	ClassDB::bind_method(D_METHOD("initialize"), &OpusAmbisonics::initialize);
+	ClassDB::bind_method(D_METHOD("encode", "pcm"), &OpusAmbisonics::encode);
+	ClassDB::bind_method(D_METHOD("decode", "packet"), &OpusAmbisonics::decode);
+	ClassDB::bind_method(D_METHOD("decode_to_stereo", "packet"), &OpusAmbisonics::decode_to_stereo);
+	ClassDB::bind_method(D_METHOD("get_frame_size"), &OpusAmbisonics::get_frame_size);
+	ClassDB::bind_method(D_METHOD("get_channel_count"), &OpusAmbisonics::get_channel_count);
+
+	ClassDB::bind_method(D_METHOD("get_listener_basis"), &OpusAmbisonics::get_listener_basis);
+	ClassDB::bind_method(D_METHOD("set_listener_basis", "p_basis"), &OpusAmbisonics::set_listener_basis);
+	ClassDB::bind_method(D_METHOD("is_encoder_enabled"), &OpusAmbisonics::is_encoder_enabled);
+	ClassDB::bind_method(D_METHOD("set_encoder_enabled", "p_encoder_enabled"), &OpusAmbisonics::set_encoder_enabled);
+	ClassDB::bind_method(D_METHOD("is_decoder_enabled"), &OpusAmbisonics::is_decoder_enabled);
+	ClassDB::bind_method(D_METHOD("set_decoder_enabled", "p_decoder_enabled"), &OpusAmbisonics::set_decoder_enabled);
+	ClassDB::bind_method(D_METHOD("get_sampling_rate"), &OpusAmbisonics::get_sampling_rate);
+	ClassDB::bind_method(D_METHOD("set_sampling_rate", "p_sampling_rate"), &OpusAmbisonics::set_sampling_rate);
+	ClassDB::bind_method(D_METHOD("get_ambisonic_order"), &OpusAmbisonics::get_ambisonic_order);
+	ClassDB::bind_method(D_METHOD("set_ambisonic_order", "p_order"), &OpusAmbisonics::set_ambisonic_order);
+	ClassDB::bind_method(D_METHOD("has_non_diegetic_stereo"), &OpusAmbisonics::has_non_diegetic_stereo);
+	ClassDB::bind_method(D_METHOD("set_non_diegetic_stereo", "p_enabled"), &OpusAmbisonics::set_non_diegetic_stereo);
+	ClassDB::bind_method(D_METHOD("get_application_mode"), &OpusAmbisonics::get_application_mode);
+	ClassDB::bind_method(D_METHOD("set_application_mode", "p_application_mode"), &OpusAmbisonics::set_application_mode);
+	ClassDB::bind_method(D_METHOD("get_frame_duration"), &OpusAmbisonics::get_frame_duration);
+	ClassDB::bind_method(D_METHOD("set_frame_duration", "p_frame_duration"), &OpusAmbisonics::set_frame_duration);
+	ClassDB::bind_method(D_METHOD("get_bitrate"), &OpusAmbisonics::get_bitrate);
+	ClassDB::bind_method(D_METHOD("set_bitrate", "p_bitrate"), &OpusAmbisonics::set_bitrate);
+	ClassDB::bind_method(D_METHOD("get_max_payload_bytes"), &OpusAmbisonics::get_max_payload_bytes);
+	ClassDB::bind_method(D_METHOD("set_max_payload_bytes", "p_max_payload_bytes"), &OpusAmbisonics::set_max_payload_bytes);
+
+	ClassDB::add_property("OpusAmbisonics", PropertyInfo(Variant::BASIS, "listener_basis"), "set_listener_basis", "get_listener_basis");
+	ClassDB::add_property("OpusAmbisonics", PropertyInfo(Variant::BOOL, "encoder_enabled"), "set_encoder_enabled", "is_encoder_enabled");
+	ClassDB::add_property("OpusAmbisonics", PropertyInfo(Variant::BOOL, "decoder_enabled"), "set_decoder_enabled", "is_decoder_enabled");
+	ClassDB::add_property("OpusAmbisonics", PropertyInfo(Variant::INT, "sampling_rate", PROPERTY_HINT_ENUM, "8 kHz:8000,12 kHz:12000,16 kHz:16000,24 kHz:24000,48 kHz:48000"), "set_sampling_rate", "get_sampling_rate");
+	ClassDB::add_property("OpusAmbisonics", PropertyInfo(Variant::INT, "ambisonic_order", PROPERTY_HINT_ENUM, "First Order:1,Second Order:2"), "set_ambisonic_order", "get_ambisonic_order");
+	ClassDB::add_property("OpusAmbisonics", PropertyInfo(Variant::BOOL, "non_diegetic_stereo"), "set_non_diegetic_stereo", "has_non_diegetic_stereo");
+	ClassDB::add_property("OpusAmbisonics", PropertyInfo(Variant::INT, "application_mode", PROPERTY_HINT_ENUM, "VoIP:2048,Audio:2049,Restricted-LowDelay:2051"), "set_application_mode", "get_application_mode");
+	ClassDB::add_property("OpusAmbisonics", PropertyInfo(Variant::INT, "frame_duration", PROPERTY_HINT_ENUM, "2.5 ms:5001,5 ms:5002,10 ms:5003,20 ms:5004,40 ms:5005,60 ms:5006,80 ms:5007,100 ms:5008,120 ms:5009"), "set_frame_duration", "get_frame_duration");
+	ClassDB::add_property("OpusAmbisonics", PropertyInfo(Variant::INT, "bitrate", PROPERTY_HINT_RANGE, "-1000,2048000,1000,suffix:bps"), "set_bitrate", "get_bitrate");
+	ClassDB::add_property("OpusAmbisonics", PropertyInfo(Variant::INT, "max_payload_bytes", PROPERTY_HINT_RANGE, "16,8000,16,suffix:B"), "set_max_payload_bytes", "get_max_payload_bytes");
+}
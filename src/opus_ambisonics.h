@@ -0,0 +1,103 @@
+#ifndef OPUS_AMBISONICS_H
+#define OPUS_AMBISONICS_H
+
+#include <opus_projection.h>
+#include <godot_cpp/classes/ref_counted.hpp>
+#include <godot_cpp/variant/basis.hpp>
+
+#include "godot_opus.h"
+
+namespace godot {
+
+// Streams first or second order ambisonics (ACN channel order, SN3D
+// normalization) with the Opus projection API, optionally followed by a
+// head-locked stereo pair. Decoded frames can be rendered to stereo for the
+// current listener orientation natively.
+class OpusAmbisonics : public RefCounted {
+	GDCLASS(OpusAmbisonics, RefCounted)
+
+	OpusProjectionEncoder *encoder;
+	OpusProjectionDecoder *decoder;
+
+	bool encoder_enabled;
+	bool decoder_enabled;
+
+	GodotOpus::SampleRate sampling_rate;
+	int ambisonic_order;
+	bool non_diegetic_stereo;
+	GodotOpus::ApplicationMode application_mode;
+	GodotOpus::FrameSizeDuration frame_duration;
+	int bitrate_bps;
+	int max_payload_bytes;
+	int frame_size;
+	int channels;
+	// Layout of the stream set up by initialize(), which the decoded frames
+	// and render gains follow until the next one
+	int stream_order;
+	bool stream_stereo;
+
+	int streams;
+	int coupled_streams;
+
+	PackedByteArray encode_data;
+	PackedFloat32Array decode_pcm;
+
+	// Gain of each ambisonic channel in the left and right output
+	Basis listener_basis;
+	float render_left[9];
+	float render_right[9];
+
+	void _destroy();
+	void _update_render_gains();
+	int _decode(const PackedByteArray &packet);
+
+protected:
+	static void _bind_methods();
+
+public:
+	OpusAmbisonics();
+	~OpusAmbisonics();
+
+	bool initialize();
+
+	PackedByteArray encode(const PackedFloat32Array &pcm);
+	PackedFloat32Array decode(const PackedByteArray &packet);
+	PackedVector2Array decode_to_stereo(const PackedByteArray &packet);
+
+	int get_frame_size() const;
+	int get_channel_count() const;
+
+	void set_listener_basis(const Basis &p_basis);
+	Basis get_listener_basis() const;
+
+	void set_encoder_enabled(const bool p_encoder_enabled);
+	bool is_encoder_enabled() const;
+
+	void set_decoder_enabled(const bool p_decoder_enabled);
+	bool is_decoder_enabled() const;
+
+	void set_sampling_rate(const GodotOpus::SampleRate p_sampling_rate);
+	GodotOpus::SampleRate get_sampling_rate() const;
+
+	void set_ambisonic_order(const int p_order);
+	int get_ambisonic_order() const;
+
+	void set_non_diegetic_stereo(const bool p_enabled);
+	bool has_non_diegetic_stereo() const;
+
+	void set_application_mode(const GodotOpus::ApplicationMode p_application_mode);
+	GodotOpus::ApplicationMode get_application_mode() const;
+
+	void set_frame_duration(const GodotOpus::FrameSizeDuration p_frame_duration);
+	GodotOpus::FrameSizeDuration get_frame_duration() const;
+
+	void set_bitrate(const int p_bitrate);
+	int get_bitrate() const;
+
+	void set_max_payload_bytes(const int p_max_payload_bytes);
+	int get_max_payload_bytes() const;
+};
+
+} //namespace godot
+
+#endif // OPUS_AMBISONICS_H
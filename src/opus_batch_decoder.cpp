@@ -0,0 +1,104 @@
+#include <godot_cpp/classes/worker_thread_pool.hpp>
+#include <godot_cpp/core/class_db.hpp>
+#include <godot_cpp/templates/hash_map.hpp>
+
+#include "opus_batch_decoder.h"
+
+using namespace godot;
+
+OpusBatchDecoder::OpusBatchDecoder() {
+	parallel_threshold = 4;
+}
+
+void OpusBatchDecoder::_decode_group(const int index) {
+	// Bound only for the group task's Callable. Outside decode() there are no
+	// groups, so a call from a script fails here.
+	ERR_FAIL_INDEX_MSG(index, (int)groups.size(), "OpusBatchDecoder _decode_group is only called by decode()");
+
+	// Each group owns its decoder and result slots, so no locking is needed
+	Group &group = groups[index];
+	for (uint32_t i = 0; i < group.jobs.size(); i++) {
+		const int job = group.jobs[i];
+		const PackedByteArray &packet = job_packets[job];
+		if (packet.is_empty()) {
+			job_results[job] = group.decoder->decode_dropped(group.decoder->get_frame_size());
+		} else {
+			job_results[job] = group.decoder->decode(packet);
+		}
+	}
+}
+
+Array OpusBatchDecoder::decode(const Array &decoders, const Array &packets) {
+	ERR_FAIL_COND_V_MSG(decoders.size() != packets.size(), Array(), "decoders and packets must be the same size");
+
+	const int count = decoders.size();
+	job_packets.resize(count);
+	job_results.resize(count);
+
+	HashMap<OpusDecoderState *, int> group_index;
+	for (int i = 0; i < count; i++) {
+		job_packets[i] = packets[i];
+		job_results[i] = PackedVector2Array();
+
+		OpusDecoderState *decoder = OpusDecoderState::from_object(decoders[i]);
+		if (decoder == NULL) {
+			ERR_PRINT("OpusBatchDecoder decoders must all be GodotOpus nodes or OpusDecoderState");
+			continue;
+		}
+
+		HashMap<OpusDecoderState *, int>::Iterator E = group_index.find(decoder);
+		if (!E) {
+			E = group_index.insert(decoder, groups.size());
+			Group group;
+			group.decoder = decoder;
+			groups.push_back(group);
+		}
+		groups[E->value].jobs.push_back(i);
+	}
+
+	const int group_count = groups.size();
+	if (group_count >= parallel_threshold && group_count > 1) {
+		WorkerThreadPool *pool = WorkerThreadPool::get_singleton();
+		int64_t task_id = pool->add_group_task(Callable(this, "_decode_group"), group_count, -1, true, "OpusBatchDecoder decode");
+		pool->wait_for_group_task_completion(task_id);
+	} else {
+		for (int i = 0; i < group_count; i++) {
+			_decode_group(i);
+		}
+	}
+
+	Array ret;
+	ret.resize(count);
+	for (int i = 0; i < count; i++) {
+		ret[i] = job_results[i];
+	}
+
+	// Don't hold on to packet and audio references between batches
+	groups.clear();
+	job_packets.clear();
+	job_results.clear();
+	return ret;
+}
+
+// Getters and Setters ////////////////////////////////////////////////////////
+
+void OpusBatchDecoder::set_parallel_threshold(const int p_parallel_threshold) {
+	ERR_FAIL_COND_MSG(p_parallel_threshold < 1, "parallel_threshold must be at least 1");
+	parallel_threshold = p_parallel_threshold;
+}
+
+int OpusBatchDecoder::get_parallel_threshold() const {
+	return parallel_threshold;
+}
+
+// Bind methods
+
+void OpusBatchDecoder::_bind_methods() {
+	ClassDB::bind_method(D_METHOD("_decode_group", "index"), &OpusBatchDecoder::_decode_group);
+	ClassDB::bind_method(D_METHOD("decode", "decoders", "packets"), &OpusBatchDecoder::decode);
+
+	ClassDB::bind_method(D_METHOD("get_parallel_threshold"), &OpusBatchDecoder::get_parallel_threshold);
+	ClassDB::bind_method(D_METHOD("set_parallel_threshold", "p_parallel_threshold"), &OpusBatchDecoder::set_parallel_threshold);
+
+	ClassDB::add_property("OpusBatchDecoder", PropertyInfo(Variant::INT, "parallel_threshold", PROPERTY_HINT_RANGE, "1,256,1"), "set_parallel_threshold", "get_parallel_threshold");
+}
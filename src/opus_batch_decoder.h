@@ -0,0 +1,46 @@
+#ifndef OPUS_BATCH_DECODER_H
+#define OPUS_BATCH_DECODER_H
+
+#include <godot_cpp/classes/ref_counted.hpp>
+#include <godot_cpp/templates/local_vector.hpp>
+
+#include "opus_decoder_state.h"
+
+namespace godot {
+
+// Decodes a batch of packets, each with its own decoder (a GodotOpus node or an
+// OpusDecoderState), spread over the WorkerThreadPool. Packets for the same
+// decoder are decoded in order on a single task, since decoder state depends on
+// the previous packet; distinct decoders run in parallel. Results come back in the order of the input.
+class OpusBatchDecoder : public RefCounted {
+	GDCLASS(OpusBatchDecoder, RefCounted)
+
+	struct Group {
+		OpusDecoderState *decoder = NULL;
+		LocalVector<int> jobs;
+	};
+
+	// Only valid during decode()
+	LocalVector<Group> groups;
+	LocalVector<PackedByteArray> job_packets;
+	LocalVector<PackedVector2Array> job_results;
+
+	int parallel_threshold;
+
+protected:
+	static void _bind_methods();
+
+	void _decode_group(const int index);
+
+public:
+	OpusBatchDecoder();
+
+	Array decode(const Array &decoders, const Array &packets);
+
+	void set_parallel_threshold(const int p_parallel_threshold);
+	int get_parallel_threshold() const;
+};
+
+} //namespace godot
+
+#endif // OPUS_BATCH_DECODER_H
@@ -0,0 +1,679 @@
+
+#include <string.h>
+
+#include <godot_cpp/classes/time.hpp>
+#include <godot_cpp/core/class_db.hpp>
+
+#include "audio_kernels.h"
+#include "opus_decoder_state.h"
+
+using namespace godot;
+
+OpusDecoderState::OpusDecoderState() {
+	decoder = NULL;
+	dred_decoder = NULL;
+	dred = NULL;
+
+	initialized = false;
+
+	sampling_rate = GodotOpus::SAMPLE_RATE_48000;
+	channels = GodotOpus::CHANNELS_STEREO;
+	frame_duration = GodotOpus::FRAMESIZE_20_MS;
+
+	skip_samples = 312; // 48 kHz, VoIP encoder gives 312 skip samples for lookahead
+	decoded_samples = 0;
+	dropped_sampling_multiple = 120; // 48kHz * 2.5ms
+
+	max_frame_size = 48000 * 120 / 1000; // Longest Opus packet is 120 ms
+	mix_rate = 0;
+	target_latency_ms = 0;
+	time_stretch = false;
+	playout_speed = 1.0;
+
+	decoder_complexity = 0;
+	decode_time_usec = 0;
+	timed_samples = 0;
+
+	_update_frame_size();
+}
+
+OpusDecoderState::~OpusDecoderState() {
+	release();
+
+	if (dred != NULL) {
+		opus_dred_free(dred);
+		dred = NULL;
+	}
+
+	if (dred_decoder != NULL) {
+		opus_dred_decoder_destroy(dred_decoder);
+		dred_decoder = NULL;
+	}
+}
+
+bool OpusDecoderState::initialize() {
+	release();
+
+	int err;
+	decoder = opus_decoder_create((int)sampling_rate, (int)channels, &err);
+
+	ERR_FAIL_COND_V_MSG(err != OPUS_OK, false, opus_strerror(err));
+
+	opus_decoder_ctl(decoder, OPUS_SET_COMPLEXITY(decoder_complexity));
+
+	// Without DRED support in libopus these fail, and decode_with_dred falls back to FEC and PLC
+	if (dred_decoder == NULL) {
+		dred_decoder = opus_dred_decoder_create(&err);
+	}
+	if (dred_decoder != NULL && dred == NULL) {
+		dred = opus_dred_alloc(&err);
+	}
+
+	decoded_samples = 0;
+
+	// Drift compensation needs the resampler even when the rates match
+	drift.set_target_ms(target_latency_ms);
+	drift.reset();
+	output_resampler.setup((int)sampling_rate, mix_rate > 0 ? mix_rate : (int)sampling_rate, (int)channels, drift.is_enabled());
+
+	stretcher.setup(output_resampler.get_output_rate(), time_stretch ? (int)channels : 0);
+	if (stretcher.is_active()) {
+		stretcher.set_speed(playout_speed);
+	}
+
+	// Scratch for one packet; longer gaps are decoded through it in pieces
+	max_frame_size = (int)sampling_rate * 120 / 1000;
+	_resize_decode_buffers(max_frame_size);
+	initialized = true;
+
+	if (!dnn_blob.is_empty()) {
+		_apply_dnn_blob();
+	}
+
+	return true;
+}
+
+void OpusDecoderState::release() {
+	initialized = false;
+
+	if (decoder != NULL) {
+		opus_decoder_destroy(decoder);
+		decoder = NULL;
+	}
+}
+
+bool OpusDecoderState::is_initialized() const {
+	return initialized;
+}
+
+PackedVector2Array OpusDecoderState::decode(const PackedByteArray data) {
+	ERR_FAIL_COND_V_MSG(!initialized, PackedVector2Array(), "OpusDecoderState not initialized");
+	const uint64_t start_usec = Time::get_singleton()->get_ticks_usec();
+
+	opus_int32 output_samples = max_frame_size;
+	output_samples = opus_decode_float(decoder, data.ptr(), data.size(), decode_data.ptrw(), output_samples, 0);
+
+	ERR_FAIL_COND_V_MSG(output_samples < 0, PackedVector2Array(), opus_strerror(output_samples));
+
+	const float *pcm;
+	const int frames = _process_decoded(output_samples, true, pcm);
+
+	decode_frames.resize(frames);
+	_write_frames(pcm, decode_frames.ptrw(), frames);
+	_count_decoded(output_samples, start_usec);
+
+	return decode_frames;
+}
+
+PackedFloat32Array OpusDecoderState::decode_raw(const PackedByteArray data) {
+	ERR_FAIL_COND_V_MSG(!initialized, PackedFloat32Array(), "OpusDecoderState not initialized");
+	const uint64_t start_usec = Time::get_singleton()->get_ticks_usec();
+
+	opus_int32 output_samples = max_frame_size;
+	output_samples = opus_decode_float(decoder, data.ptr(), data.size(), decode_data.ptrw(), output_samples, 0);
+
+	ERR_FAIL_COND_V_MSG(output_samples < 0, PackedFloat32Array(), opus_strerror(output_samples));
+
+	const float *pcm;
+	const int frames = _process_decoded(output_samples, true, pcm);
+
+	decode_samples.resize(frames * (int)channels);
+	memcpy(decode_samples.ptrw(), pcm, sizeof(float) * frames * (int)channels);
+	_count_decoded(output_samples, start_usec);
+
+	return decode_samples;
+}
+
+PackedFloat32Array OpusDecoderState::decode_mono(const PackedByteArray data) {
+	ERR_FAIL_COND_V_MSG(!initialized, PackedFloat32Array(), "OpusDecoderState not initialized");
+	const uint64_t start_usec = Time::get_singleton()->get_ticks_usec();
+
+	opus_int32 output_samples = max_frame_size;
+	output_samples = opus_decode_float(decoder, data.ptr(), data.size(), decode_data.ptrw(), output_samples, 0);
+
+	ERR_FAIL_COND_V_MSG(output_samples < 0, PackedFloat32Array(), opus_strerror(output_samples));
+
+	const float *pcm;
+	const int frames = _process_decoded(output_samples, true, pcm);
+
+	decode_samples.resize(frames);
+	_write_mono(pcm, decode_samples.ptrw(), frames);
+	_count_decoded(output_samples, start_usec);
+
+	return decode_samples;
+}
+
+PackedVector2Array OpusDecoderState::decode_dropped(const int dropped_samples) {
+	ERR_FAIL_COND_V_MSG(!initialized, PackedVector2Array(), "OpusDecoderState not initialized");
+	const uint64_t start_usec = Time::get_singleton()->get_ticks_usec();
+
+	decode_frames.resize(0);
+	const int output_samples = _conceal(_dropped_frame_size(dropped_samples), false);
+
+	ERR_FAIL_COND_V_MSG(output_samples < 0, PackedVector2Array(), opus_strerror(output_samples));
+
+	// Concealed and comfort noise frames still advance the stream position
+	_count_decoded(output_samples, start_usec);
+
+	return decode_frames;
+}
+
+PackedFloat32Array OpusDecoderState::decode_dropped_raw(const int dropped_samples) {
+	ERR_FAIL_COND_V_MSG(!initialized, PackedFloat32Array(), "OpusDecoderState not initialized");
+	const uint64_t start_usec = Time::get_singleton()->get_ticks_usec();
+
+	decode_samples.resize(0);
+	const int output_samples = _conceal(_dropped_frame_size(dropped_samples), true);
+
+	ERR_FAIL_COND_V_MSG(output_samples < 0, PackedFloat32Array(), opus_strerror(output_samples));
+
+	_count_decoded(output_samples, start_usec);
+
+	return decode_samples;
+}
+
+PackedVector2Array OpusDecoderState::decode_with_fec(const PackedByteArray next_packet, const int lost_samples) {
+	ERR_FAIL_COND_V_MSG(!initialized, PackedVector2Array(), "OpusDecoderState not initialized");
+	const uint64_t start_usec = Time::get_singleton()->get_ticks_usec();
+
+	decode_frames.resize(0);
+	const int output_samples = _decode_fec(next_packet, lost_samples, false);
+
+	ERR_FAIL_COND_V_MSG(output_samples < 0, PackedVector2Array(), opus_strerror(output_samples));
+
+	_count_decoded(output_samples, start_usec);
+
+	return decode_frames;
+}
+
+PackedFloat32Array OpusDecoderState::decode_with_fec_raw(const PackedByteArray next_packet, const int lost_samples) {
+	ERR_FAIL_COND_V_MSG(!initialized, PackedFloat32Array(), "OpusDecoderState not initialized");
+	const uint64_t start_usec = Time::get_singleton()->get_ticks_usec();
+
+	decode_samples.resize(0);
+	const int output_samples = _decode_fec(next_packet, lost_samples, true);
+
+	ERR_FAIL_COND_V_MSG(output_samples < 0, PackedFloat32Array(), opus_strerror(output_samples));
+
+	_count_decoded(output_samples, start_usec);
+
+	return decode_samples;
+}
+
+PackedVector2Array OpusDecoderState::decode_with_dred(const PackedByteArray next_packet, const int lost_samples) {
+	ERR_FAIL_COND_V_MSG(!initialized, PackedVector2Array(), "OpusDecoderState not initialized");
+	const uint64_t start_usec = Time::get_singleton()->get_ticks_usec();
+
+	decode_frames.resize(0);
+	const int output_samples = _decode_dred(next_packet, lost_samples, false);
+
+	ERR_FAIL_COND_V_MSG(output_samples < 0, PackedVector2Array(), opus_strerror(output_samples));
+
+	_count_decoded(output_samples, start_usec);
+
+	return decode_frames;
+}
+
+PackedFloat32Array OpusDecoderState::decode_with_dred_raw(const PackedByteArray next_packet, const int lost_samples) {
+	ERR_FAIL_COND_V_MSG(!initialized, PackedFloat32Array(), "OpusDecoderState not initialized");
+	const uint64_t start_usec = Time::get_singleton()->get_ticks_usec();
+
+	decode_samples.resize(0);
+	const int output_samples = _decode_dred(next_packet, lost_samples, true);
+
+	ERR_FAIL_COND_V_MSG(output_samples < 0, PackedFloat32Array(), opus_strerror(output_samples));
+
+	_count_decoded(output_samples, start_usec);
+
+	return decode_samples;
+}
+
+bool OpusDecoderState::is_dred_available() const {
+	return initialized && dred != NULL;
+}
+
+bool OpusDecoderState::load_dnn_blob(const PackedByteArray &blob) {
+	ERR_FAIL_COND_V_MSG(blob.is_empty(), false, "DNN blob is empty");
+	// Sharing one blob between states keeps a single copy of the weights in memory
+	dnn_blob = blob;
+	if (!initialized) {
+		return true;
+	}
+	return _apply_dnn_blob();
+}
+
+void OpusDecoderState::update_playout_latency(const int buffered_frames) {
+	ERR_FAIL_COND_MSG(!initialized, "OpusDecoderState not initialized");
+	ERR_FAIL_COND_MSG(!drift.is_enabled(), "Set target_latency_ms before initialize() to compensate clock drift");
+	ERR_FAIL_COND_MSG(buffered_frames < 0, "buffered_frames must not be negative");
+
+	// Measured at the rate decode() returns, then turned into a ratio change
+	// of a few hundred ppm at most, applied from the next decode on
+	const double latency_ms = buffered_frames * 1000.0 / output_resampler.get_output_rate();
+	output_resampler.set_ratio_scale(drift.update(latency_ms));
+
+	if (stretcher.is_active()) {
+		// Drift correction is far too slow for a burst after a network stall,
+		// so beyond twice the target the backlog is played faster, and below
+		// half of it playout slows down to ride out the underrun
+		const double ratio = latency_ms / target_latency_ms;
+		const double speed = ratio > 2.0 ? ratio / 2.0 : (ratio < 0.5 ? ratio + 0.5 : 1.0);
+		stretcher.set_speed(speed);
+		playout_speed = stretcher.get_speed();
+	}
+}
+
+Dictionary OpusDecoderState::get_decoder_stats() const {
+	Dictionary stats;
+	stats["decoder_complexity"] = decoder_complexity;
+	stats["decode_time_usec"] = decode_time_usec;
+	stats["decoded_samples"] = timed_samples;
+	// Fraction of one core needed to decode in real time
+	const double audio_usec = (double)timed_samples * 1000000.0 / (int)sampling_rate;
+	stats["cpu_load"] = audio_usec > 0.0 ? decode_time_usec / audio_usec : 0.0;
+	// Smoothed playout latency and the resulting rate change, with target_latency_ms set
+	stats["playout_latency_ms"] = drift.get_latency_ms();
+	stats["rate_adjustment_ppm"] = (drift.get_scale() - 1.0) * 1000000.0;
+	stats["playout_speed"] = playout_speed;
+	return stats;
+}
+
+void OpusDecoderState::reset_decoder_stats() {
+	decode_time_usec = 0;
+	timed_samples = 0;
+}
+
+int OpusDecoderState::reset_decoder_count() {
+	// Can overflow, but shouldn't matter.
+	int count = decoded_samples;
+	decoded_samples = 0;
+	output_resampler.reset();
+	stretcher.reset();
+	return count;
+}
+
+int OpusDecoderState::get_decoder_count() const {
+	// Can overflow; matches what reset does.
+	int count = decoded_samples;
+	return count;
+}
+
+OpusDecoderState *OpusDecoderState::from_object(Object *p_object) {
+	GodotOpus *opus = Object::cast_to<GodotOpus>(p_object);
+	if (opus != NULL) {
+		return opus->get_decoder_state().ptr();
+	}
+	return Object::cast_to<OpusDecoderState>(p_object);
+}
+
+// Protected internal methods ///////////////////////////////////////////////
+
+int OpusDecoderState::_dropped_frame_size(const int samples) const {
+	if (samples % dropped_sampling_multiple == 0) {
+		return samples;
+	}
+	return samples - (samples % dropped_sampling_multiple) + dropped_sampling_multiple;
+}
+
+void OpusDecoderState::_resize_decode_buffers(const int frames) {
+	// Each stage of the decode chain gets room for what the one before can output
+	const int ch = (int)channels;
+	decode_data.resize(frames * ch);
+	const int resampled = output_resampler.get_max_output(frames);
+	if (output_resampler.is_active()) {
+		decode_resampled.resize(resampled * ch);
+	}
+	if (stretcher.is_active()) {
+		decode_stretched.resize(stretcher.get_max_output(resampled) * ch);
+	}
+}
+
+int OpusDecoderState::_conceal(const int samples, const bool raw) {
+	// Gaps longer than a packet go through the scratch a packet at a time
+	int decoded = 0;
+	while (decoded < samples) {
+		const int ret = opus_decode_float(decoder, NULL, 0, decode_data.ptrw(), MIN(samples - decoded, max_frame_size), 0);
+		if (ret <= 0) {
+			return ret < 0 ? ret : decoded;
+		}
+		_append_decoded(ret, raw);
+		decoded += ret;
+	}
+	return decoded;
+}
+
+int OpusDecoderState::_decode_fec(const PackedByteArray &next_packet, const int lost_samples, const bool raw) {
+	// The recovered frame has to be exactly as long as the audio that was lost
+	const int gap = _dropped_frame_size(lost_samples);
+	if (next_packet.is_empty() || opus_packet_has_lbrr(next_packet.ptr(), next_packet.size()) != 1) {
+		// No redundancy to recover from, conceal instead
+		return _conceal(gap, raw);
+	}
+
+	// The FEC copy ends the gap; in a gap longer than a packet, the start of it
+	// is concealed first
+	const int last = MIN(gap, max_frame_size);
+	const int concealed = _conceal(gap - last, raw);
+	if (concealed < 0) {
+		return concealed;
+	}
+	const int ret = opus_decode_float(decoder, next_packet.ptr(), next_packet.size(), decode_data.ptrw(), last, 1);
+	if (ret < 0) {
+		return ret;
+	}
+	_append_decoded(ret, raw);
+	return concealed + ret;
+}
+
+int OpusDecoderState::_process_decoded(const int output_samples, const bool skip, const float *&r_pcm) {
+	// Drops the encoder lookahead at the start of the stream, then converts to
+	// mix_rate if set and time-stretches when enabled. Returns the frames left,
+	// starting at r_pcm.
+	const int ch = (int)channels;
+	const float *pcm = decode_data.ptr();
+	int frames = output_samples;
+	if (skip && decoded_samples < skip_samples) {
+		const int skipped = (int)MIN((int64_t)frames, skip_samples - decoded_samples);
+		pcm += skipped * ch;
+		frames -= skipped;
+	}
+
+	if (output_resampler.is_active() && frames > 0) {
+		frames = output_resampler.process(pcm, frames, decode_resampled.ptr());
+		pcm = decode_resampled.ptr();
+	}
+
+	if (stretcher.is_active() && frames > 0) {
+		frames = stretcher.process(pcm, frames, decode_stretched.ptr());
+		pcm = decode_stretched.ptr();
+	}
+
+	r_pcm = pcm;
+	return frames;
+}
+
+void OpusDecoderState::_append_decoded(const int output_samples, const bool raw) {
+	// Gaps are decoded a piece at a time, each appended to decode_samples if
+	// raw and to decode_frames otherwise
+	const float *pcm;
+	const int frames = _process_decoded(output_samples, false, pcm);
+	if (raw) {
+		const int ch = (int)channels;
+		const int size = decode_samples.size();
+		decode_samples.resize(size + frames * ch);
+		memcpy(decode_samples.ptrw() + size, pcm, sizeof(float) * frames * ch);
+	} else {
+		const int size = decode_frames.size();
+		decode_frames.resize(size + frames);
+		_write_frames(pcm, decode_frames.ptrw() + size, frames);
+	}
+}
+
+void OpusDecoderState::_write_frames(const float *pcm, Vector2 *dst, const int frames) const {
+	if (channels == GodotOpus::CHANNELS_STEREO) {
+		// Interleaved stereo case
+		AudioKernels::deinterleave_stereo(pcm, dst, frames);
+	} else {
+		// Mono case
+		for (int i = 0; i < frames; i++) {
+			dst[i] = Vector2(pcm[i], pcm[i]);
+		}
+	}
+}
+
+void OpusDecoderState::_write_mono(const float *pcm, float *dst, const int frames) const {
+	if (channels == GodotOpus::CHANNELS_STEREO) {
+		AudioKernels::downmix_mono(pcm, dst, frames);
+	} else {
+		memcpy(dst, pcm, sizeof(float) * frames);
+	}
+}
+
+void OpusDecoderState::_count_decoded(const int samples, const uint64_t start_usec) {
+	decoded_samples += samples;
+	timed_samples += samples;
+	decode_time_usec += Time::get_singleton()->get_ticks_usec() - start_usec;
+}
+
+bool OpusDecoderState::_apply_dnn_blob() {
+	// libopus points into the blob rather than copying it, so dnn_blob has to
+	// outlive the decoder states. It only takes a blob when built with
+	// USE_WEIGHTS_FILE, and reports OPUS_UNIMPLEMENTED otherwise.
+	const uint8_t *data = dnn_blob.ptr();
+	const int len = dnn_blob.size();
+	int err = opus_decoder_ctl(decoder, OPUS_SET_DNN_BLOB(data, len));
+	if (err == OPUS_OK && dred_decoder != NULL) {
+		err = opus_dred_decoder_ctl(dred_decoder, OPUS_SET_DNN_BLOB(data, len));
+	}
+	ERR_FAIL_COND_V_MSG(err == OPUS_UNIMPLEMENTED, false, "Failed to load DNN blob, libopus built without USE_WEIGHTS_FILE");
+	ERR_FAIL_COND_V_MSG(err != OPUS_OK, false, "Failed to load DNN blob, it may not match this version of libopus");
+	return true;
+}
+
+int OpusDecoderState::_decode_dred(const PackedByteArray &next_packet, const int lost_samples, const bool raw) {
+	// Fills the gap one frame at a time, oldest first. Each frame is decoded from
+	// the DRED data if it reaches back that far; the frame just before next_packet
+	// prefers its LBRR copy (FEC), and anything left uncovered is concealed.
+	// Frames are collected in the scratch and passed on whenever it fills up.
+	const int ch = (int)channels;
+	const int gap = _dropped_frame_size(lost_samples);
+
+	int dred_reach = 0;
+	const bool has_packet = !next_packet.is_empty();
+	if (has_packet && dred != NULL) {
+		int dred_end = 0;
+		int ret = opus_dred_parse(dred_decoder, dred, next_packet.ptr(), next_packet.size(), gap, (int)sampling_rate, &dred_end, 0);
+		dred_reach = MAX(0, ret);
+	}
+	const bool has_fec = has_packet && opus_packet_has_lbrr(next_packet.ptr(), next_packet.size()) == 1;
+
+	int decoded = 0;
+	int buffered = 0;
+	while (decoded < gap) {
+		// Offset is the distance from the start of this frame to the start of next_packet
+		const int offset = gap - decoded;
+		const int samples = MIN(frame_size, offset);
+		if (buffered + samples > max_frame_size) {
+			_append_decoded(buffered, raw);
+			buffered = 0;
+		}
+		float *pcm = decode_data.ptrw() + buffered * ch;
+
+		int ret;
+		if (samples == offset && has_fec) {
+			ret = opus_decode_float(decoder, next_packet.ptr(), next_packet.size(), pcm, samples, 1);
+		} else if (offset <= dred_reach) {
+			ret = opus_decoder_dred_decode_float(decoder, dred, offset, pcm, samples);
+		} else {
+			ret = opus_decode_float(decoder, NULL, 0, pcm, samples, 0);
+		}
+
+		if (ret < 0) {
+			return ret;
+		}
+		if (ret == 0) {
+			break;
+		}
+		decoded += ret;
+		buffered += ret;
+	}
+	if (buffered > 0) {
+		_append_decoded(buffered, raw);
+	}
+	return decoded;
+}
+
+void OpusDecoderState::_update_frame_size() {
+	frame_size = GodotOpus::calculate_frame_size((int)sampling_rate, frame_duration);
+}
+
+// Getters and Setters ////////////////////////////////////////////////////////
+
+void OpusDecoderState::set_sampling_rate(const GodotOpus::SampleRate p_sampling_rate) {
+	sampling_rate = p_sampling_rate;
+	dropped_sampling_multiple = (int)sampling_rate / 400;
+	_update_frame_size();
+}
+
+GodotOpus::SampleRate OpusDecoderState::get_sampling_rate() const {
+	return sampling_rate;
+}
+
+void OpusDecoderState::set_channels(const GodotOpus::Channels p_channels) {
+	channels = p_channels;
+}
+
+GodotOpus::Channels OpusDecoderState::get_channels() const {
+	return channels;
+}
+
+void OpusDecoderState::set_frame_duration(const GodotOpus::FrameSizeDuration p_frame_duration) {
+	frame_duration = p_frame_duration;
+	_update_frame_size();
+}
+
+GodotOpus::FrameSizeDuration OpusDecoderState::get_frame_duration() const {
+	return frame_duration;
+}
+
+int OpusDecoderState::get_frame_size() const {
+	return frame_size;
+}
+
+void OpusDecoderState::set_mix_rate(const int p_mix_rate) {
+	ERR_FAIL_COND_MSG(p_mix_rate < 0 || p_mix_rate > 192000, "mix_rate outside valid range 0-192000");
+	mix_rate = p_mix_rate;
+}
+
+int OpusDecoderState::get_mix_rate() const {
+	return mix_rate;
+}
+
+void OpusDecoderState::set_target_latency_ms(const float p_target_latency_ms) {
+	ERR_FAIL_COND_MSG(p_target_latency_ms < 0 || p_target_latency_ms > 2000, "target_latency_ms outside valid range 0-2000");
+	target_latency_ms = p_target_latency_ms;
+}
+
+float OpusDecoderState::get_target_latency_ms() const {
+	return target_latency_ms;
+}
+
+void OpusDecoderState::set_time_stretch(const bool p_time_stretch) {
+	time_stretch = p_time_stretch;
+}
+
+bool OpusDecoderState::is_time_stretch() const {
+	return time_stretch;
+}
+
+void OpusDecoderState::set_skip_samples(const int p_skip_samples) {
+	skip_samples = p_skip_samples;
+}
+
+int OpusDecoderState::get_skip_samples() const {
+	return skip_samples;
+}
+
+// Dynamic properties (don't require re-initialize() to be applied)
+
+void OpusDecoderState::set_decoder_complexity(const int p_complexity) {
+	ERR_FAIL_COND_MSG(p_complexity < 0 || p_complexity > 10, "decoder_complexity outside valid range 0-10");
+	decoder_complexity = p_complexity;
+	if (initialized) {
+		opus_decoder_ctl(decoder, OPUS_SET_COMPLEXITY(decoder_complexity));
+	}
+}
+
+int OpusDecoderState::get_decoder_complexity() const {
+	return decoder_complexity;
+}
+
+void OpusDecoderState::set_playout_speed(const float p_playout_speed) {
+	ERR_FAIL_COND_MSG(p_playout_speed < AudioTimeStretch::MIN_SPEED || p_playout_speed > AudioTimeStretch::MAX_SPEED, "playout_speed outside valid range 0.8-1.25");
+	playout_speed = p_playout_speed;
+	if (stretcher.is_active()) {
+		stretcher.set_speed(playout_speed);
+	}
+}
+
+float OpusDecoderState::get_playout_speed() const {
+	return playout_speed;
+}
+
+// Bind methods
+
+void OpusDecoderState::_bind_methods() {
+	ClassDB::bind_method(D_METHOD("initialize"), &OpusDecoderState::initialize);
+	ClassDB::bind_method(D_METHOD("release"), &OpusDecoderState::release);
+	ClassDB::bind_method(D_METHOD("is_initialized"), &OpusDecoderState::is_initialized);
+	ClassDB::bind_method(D_METHOD("get_frame_size"), &OpusDecoderState::get_frame_size);
+
+	ClassDB::bind_method(D_METHOD("decode", "data"), &OpusDecoderState::decode);
+	ClassDB::bind_method(D_METHOD("decode_raw", "data"), &OpusDecoderState::decode_raw);
+	ClassDB::bind_method(D_METHOD("decode_mono", "data"), &OpusDecoderState::decode_mono);
+	ClassDB::bind_method(D_METHOD("decode_dropped", "dropped_samples"), &OpusDecoderState::decode_dropped);
+	ClassDB::bind_method(D_METHOD("decode_dropped_raw", "dropped_samples"), &OpusDecoderState::decode_dropped_raw);
+	ClassDB::bind_method(D_METHOD("decode_with_fec", "next_packet", "lost_samples"), &OpusDecoderState::decode_with_fec);
+	ClassDB::bind_method(D_METHOD("decode_with_fec_raw", "next_packet", "lost_samples"), &OpusDecoderState::decode_with_fec_raw);
+	ClassDB::bind_method(D_METHOD("decode_with_dred", "next_packet", "lost_samples"), &OpusDecoderState::decode_with_dred);
+	ClassDB::bind_method(D_METHOD("decode_with_dred_raw", "next_packet", "lost_samples"), &OpusDecoderState::decode_with_dred_raw);
+	ClassDB::bind_method(D_METHOD("is_dred_available"), &OpusDecoderState::is_dred_available);
+	ClassDB::bind_method(D_METHOD("load_dnn_blob", "blob"), &OpusDecoderState::load_dnn_blob);
+	ClassDB::bind_method(D_METHOD("update_playout_latency", "buffered_frames"), &OpusDecoderState::update_playout_latency);
+	ClassDB::bind_method(D_METHOD("get_decoder_stats"), &OpusDecoderState::get_decoder_stats);
+	ClassDB::bind_method(D_METHOD("reset_decoder_stats"), &OpusDecoderState::reset_decoder_stats);
+
+	ClassDB::bind_method(D_METHOD("get_decoder_count"), &OpusDecoderState::get_decoder_count);
+	ClassDB::bind_method(D_METHOD("reset_decoder_count"), &OpusDecoderState::reset_decoder_count);
+	ClassDB::bind_method(D_METHOD("get_skip_samples"), &OpusDecoderState::get_skip_samples);
+	ClassDB::bind_method(D_METHOD("set_skip_samples", "p_skip_samples"), &OpusDecoderState::set_skip_samples);
+
+	ClassDB::bind_method(D_METHOD("get_sampling_rate"), &OpusDecoderState::get_sampling_rate);
+	ClassDB::bind_method(D_METHOD("set_sampling_rate", "p_sampling_rate"), &OpusDecoderState::set_sampling_rate);
+	ClassDB::bind_method(D_METHOD("get_channels"), &OpusDecoderState::get_channels);
+	ClassDB::bind_method(D_METHOD("set_channels", "p_channels"), &OpusDecoderState::set_channels);
+	ClassDB::bind_method(D_METHOD("get_frame_duration"), &OpusDecoderState::get_frame_duration);
+	ClassDB::bind_method(D_METHOD("set_frame_duration", "p_frame_duration"), &OpusDecoderState::set_frame_duration);
+
+	ClassDB::bind_method(D_METHOD("get_decoder_complexity"), &OpusDecoderState::get_decoder_complexity);
+	ClassDB::bind_method(D_METHOD("set_decoder_complexity", "p_complexity"), &OpusDecoderState::set_decoder_complexity);
+	ClassDB::bind_method(D_METHOD("get_playout_speed"), &OpusDecoderState::get_playout_speed);
+	ClassDB::bind_method(D_METHOD("set_playout_speed", "p_playout_speed"), &OpusDecoderState::set_playout_speed);
+
+	ClassDB::bind_method(D_METHOD("get_mix_rate"), &OpusDecoderState::get_mix_rate);
+	ClassDB::bind_method(D_METHOD("set_mix_rate", "p_mix_rate"), &OpusDecoderState::set_mix_rate);
+	ClassDB::bind_method(D_METHOD("get_target_latency_ms"), &OpusDecoderState::get_target_latency_ms);
+	ClassDB::bind_method(D_METHOD("set_target_latency_ms", "p_target_latency_ms"), &OpusDecoderState::set_target_latency_ms);
+	ClassDB::bind_method(D_METHOD("is_time_stretch"), &OpusDecoderState::is_time_stretch);
+	ClassDB::bind_method(D_METHOD("set_time_stretch", "p_time_stretch"), &OpusDecoderState::set_time_stretch);
+
+	ClassDB::add_property("OpusDecoderState", PropertyInfo(Variant::INT, "sampling_rate", PROPERTY_HINT_ENUM, "8 kHz:8000,12 kHz:12000,16 kHz:16000,24 kHz:24000,48 kHz:48000"), "set_sampling_rate", "get_sampling_rate");
+	ClassDB::add_property("OpusDecoderState", PropertyInfo(Variant::INT, "channels", PROPERTY_HINT_ENUM, "Mono:1,Stereo:2"), "set_channels", "get_channels");
+	ClassDB::add_property("OpusDecoderState", PropertyInfo(Variant::INT, "frame_duration", PROPERTY_HINT_ENUM, "2.5 ms:5001,5 ms:5002,10 ms:5003,20 ms:5004,40 ms:5005,60 ms:5006,80 ms:5007,100 ms:5008,120 ms:5009"), "set_frame_duration", "get_frame_duration");
+	ClassDB::add_property("OpusDecoderState", PropertyInfo(Variant::INT, "decoder_complexity", PROPERTY_HINT_RANGE, "0,10,1"), "set_decoder_complexity", "get_decoder_complexity");
+	ClassDB::add_property("OpusDecoderState", PropertyInfo(Variant::FLOAT, "playout_speed", PROPERTY_HINT_RANGE, "0.8,1.25,0.01"), "set_playout_speed", "get_playout_speed");
+	ClassDB::add_property("OpusDecoderState", PropertyInfo(Variant::INT, "mix_rate", PROPERTY_HINT_RANGE, "0,192000,1,suffix:Hz"), "set_mix_rate", "get_mix_rate");
+	ClassDB::add_property("OpusDecoderState", PropertyInfo(Variant::FLOAT, "target_latency_ms", PROPERTY_HINT_RANGE, "0,2000,1,suffix:ms"), "set_target_latency_ms", "get_target_latency_ms");
+	ClassDB::add_property("OpusDecoderState", PropertyInfo(Variant::BOOL, "time_stretch"), "set_time_stretch", "is_time_stretch");
+	ClassDB::add_property("OpusDecoderState", PropertyInfo(Variant::INT, "skip_samples", PROPERTY_HINT_RANGE, "0,960,1"), "set_skip_samples", "get_skip_samples");
+}
@@ -0,0 +1,176 @@
+#ifndef OPUS_DECODER_STATE_H
+#define OPUS_DECODER_STATE_H
+
+#include <opus.h>
+#include <godot_cpp/classes/ref_counted.hpp>
+#include <godot_cpp/templates/local_vector.hpp>
+
+#include "audio_resampler.h"
+#include "audio_time_stretch.h"
+#include "godot_opus.h"
+
+namespace godot {
+
+// An Opus decoder with its output scratch and playout stages (resampling,
+// drift compensation, time stretch), without the scene tree. GodotOpus wraps
+// one; on its own it can be kept in an array per stream (e.g. a decoder per
+// speaker on a relay) and used from any thread, one thread at a time.
+class OpusDecoderState : public RefCounted {
+	GDCLASS(OpusDecoderState, RefCounted)
+
+	OpusDecoder *decoder;
+	// Only created when libopus is built with DRED support (OPUS_DRED)
+	OpusDREDDecoder *dred_decoder;
+	OpusDRED *dred;
+
+	bool initialized;
+
+	PackedFloat32Array decode_data;
+
+	// Decoded audio is written into these and returned, sharing the buffer with
+	// the caller. The next decode only reuses it if that result was dropped by
+	// then (e.g. pushed straight to a playback); if it's still referenced, even by
+	// a script variable about to be reassigned, writing copies it first.
+	PackedVector2Array decode_frames;
+	PackedFloat32Array decode_samples;
+
+	int skip_samples;
+	int64_t decoded_samples;
+	int dropped_sampling_multiple;
+
+	GodotOpus::SampleRate sampling_rate;
+	GodotOpus::Channels channels;
+	GodotOpus::FrameSizeDuration frame_duration;
+
+	// Frames (per channel) of the longest packet at sampling_rate, which the
+	// decode scratch is sized for
+	int max_frame_size;
+	int frame_size;
+
+	// Rate of the audio returned, when it isn't sampling_rate (e.g. the
+	// AudioServer mix rate)
+	int mix_rate;
+	// Playout latency the decode output is steered toward by small resampling
+	// ratio changes, following the sender's clock (0 disables)
+	float target_latency_ms;
+	DriftCompensator drift;
+	AudioResampler output_resampler;
+	LocalVector<float> decode_resampled;
+
+	// Pitch-preserving speed change of the decode output, to catch up on a
+	// backlog or stretch through an underrun
+	bool time_stretch;
+	float playout_speed;
+	AudioTimeStretch stretcher;
+	LocalVector<float> decode_stretched;
+
+	int decoder_complexity;
+
+	// Weights for the DNN features (deep PLC, DRED, OSCE), if not built in
+	PackedByteArray dnn_blob;
+
+	// Time spent in the decode calls, and the samples they produced
+	uint64_t decode_time_usec;
+	int64_t timed_samples;
+
+protected:
+	static void _bind_methods();
+
+	int _dropped_frame_size(const int samples) const;
+	void _resize_decode_buffers(const int frames);
+	int _conceal(const int samples, const bool raw);
+	int _decode_fec(const PackedByteArray &next_packet, const int lost_samples, const bool raw);
+	int _decode_dred(const PackedByteArray &next_packet, const int lost_samples, const bool raw);
+	int _process_decoded(const int output_samples, const bool skip, const float *&r_pcm);
+	void _append_decoded(const int output_samples, const bool raw);
+	void _write_frames(const float *pcm, Vector2 *dst, const int frames) const;
+	void _write_mono(const float *pcm, float *dst, const int frames) const;
+	void _count_decoded(const int samples, const uint64_t start_usec);
+	bool _apply_dnn_blob();
+	void _update_frame_size();
+
+public:
+	OpusDecoderState();
+	~OpusDecoderState();
+
+	// Creates the decoder with the current properties, replacing any previous one
+	bool initialize();
+	// Frees the decoder until the next initialize()
+	void release();
+	bool is_initialized() const;
+
+	// Decode an encoded packet
+	PackedVector2Array decode(const PackedByteArray data);
+	PackedFloat32Array decode_raw(const PackedByteArray data);
+	// One sample per frame, e.g. for positional voice, downmixed if the stream is stereo
+	PackedFloat32Array decode_mono(const PackedByteArray data);
+
+	// Decode (and inform decoder of) dropped packet, in terms of sample length of the packet
+	PackedVector2Array decode_dropped(const int dropped_samples);
+	PackedFloat32Array decode_dropped_raw(const int dropped_samples);
+
+	// Recover a dropped packet from the in-band FEC data of the packet after it
+	PackedVector2Array decode_with_fec(const PackedByteArray next_packet, const int lost_samples);
+	PackedFloat32Array decode_with_fec_raw(const PackedByteArray next_packet, const int lost_samples);
+
+	// Rebuild a burst of lost audio from the DRED data in the first packet after it
+	PackedVector2Array decode_with_dred(const PackedByteArray next_packet, const int lost_samples);
+	PackedFloat32Array decode_with_dred_raw(const PackedByteArray next_packet, const int lost_samples);
+	bool is_dred_available() const;
+
+	// Replace the DNN weights with a blob (as written by write_lpcnet_weights)
+	bool load_dnn_blob(const PackedByteArray &blob);
+
+	// Reports the decoded frames still queued for playout, see GodotOpus
+	void update_playout_latency(const int buffered_frames);
+
+	// CPU time spent decoding, to weigh decoder_complexity against
+	Dictionary get_decoder_stats() const;
+	void reset_decoder_stats();
+
+	// Resets the decoded samples count, reinitiating the skipped frames. Returns decoded samples before reset.
+	int reset_decoder_count();
+	int get_decoder_count() const;
+
+	// The decoder of a GodotOpus node, or the object itself if it's an
+	// OpusDecoderState. NULL for anything else.
+	static OpusDecoderState *from_object(Object *p_object);
+
+	// Property getters/setters
+
+	void set_sampling_rate(const GodotOpus::SampleRate p_sampling_rate);
+	GodotOpus::SampleRate get_sampling_rate() const;
+
+	void set_channels(const GodotOpus::Channels p_channels);
+	GodotOpus::Channels get_channels() const;
+
+	void set_frame_duration(const GodotOpus::FrameSizeDuration p_frame_duration);
+	GodotOpus::FrameSizeDuration get_frame_duration() const;
+
+	void set_mix_rate(const int p_mix_rate);
+	int get_mix_rate() const;
+
+	void set_target_latency_ms(const float p_target_latency_ms);
+	float get_target_latency_ms() const;
+
+	void set_time_stretch(const bool p_time_stretch);
+	bool is_time_stretch() const;
+
+	void set_skip_samples(const int p_skip_samples);
+	int get_skip_samples() const;
+
+	// Dynamic properties
+
+	void set_decoder_complexity(const int p_complexity);
+	int get_decoder_complexity() const;
+
+	void set_playout_speed(const float p_playout_speed);
+	float get_playout_speed() const;
+
+	// Not exposed as a property
+	int get_frame_size() const;
+};
+
+} //namespace godot
+
+#endif // OPUS_DECODER_STATE_H
@@ -0,0 +1,881 @@
+
+#include <string.h>
+
+#include <godot_cpp/classes/worker_thread_pool.hpp>
+#include <godot_cpp/core/class_db.hpp>
+#include <godot_cpp/core/mutex_lock.hpp>
+
+#include "audio_kernels.h"
+#include "opus_encoder_state.h"
+
+using namespace godot;
+
+OpusEncoderState::OpusEncoderState() {
+	encoder = NULL;
+	repacketizer = NULL;
+
+	initialized = false;
+	buffer_initialized = false;
+
+	sampling_rate = GodotOpus::SAMPLE_RATE_48000;
+	channels = GodotOpus::CHANNELS_STEREO;
+	application_mode = GodotOpus::APPLICATION_MODE_VOIP;
+	frame_duration = GodotOpus::FRAMESIZE_20_MS;
+	bandwidth = GodotOpus::BANDWIDTH_AUTO;
+	max_bandwidth = GodotOpus::BANDWIDTH_FULLBAND;
+
+	max_payload_bytes = 1024;
+	payload_bytes = max_payload_bytes;
+	lookahead = 312; // 48 kHz, VoIP encoder gives 312 samples of lookahead
+	mix_rate = 0;
+	frames_per_packet = 1;
+	packet_frames = 1;
+	repacket_frames = 0;
+	buffer_length_seconds = 0.5;
+
+	bitrate_mode = GodotOpus::BITRATE_VARIABLE_AUTO;
+	bitrate_bps = 120000; // Default bitrate for 48 kHz stereo
+	encoder_complexity = 10;
+	packet_loss_perc = 0;
+	inband_fec = false;
+	dtx = false;
+	dred_duration_ms = 0;
+
+	async_encoding = false;
+	encode_task_id = -1;
+	encode_mutex.instantiate();
+	encoder_mutex.instantiate();
+	signal_owner = this;
+
+	_update_frame_size();
+}
+
+OpusEncoderState::~OpusEncoderState() {
+	release();
+
+	if (repacketizer != NULL) {
+		opus_repacketizer_destroy(repacketizer);
+		repacketizer = NULL;
+	}
+}
+
+bool OpusEncoderState::initialize() {
+	release();
+
+	int err;
+	encoder = opus_encoder_create((int)sampling_rate, (int)channels, (int)application_mode, &err);
+
+	ERR_FAIL_COND_V_MSG(err != OPUS_OK, false, opus_strerror(err));
+
+	opus_encoder_ctl(encoder, OPUS_SET_BANDWIDTH((int)bandwidth));
+
+	opus_int32 max_bw;
+	if (max_bandwidth == GodotOpus::BANDWIDTH_AUTO) {
+		// Allow max_bandwidth to be set to auto, but in that case,
+		// fall back to fullband, let normal bandwidth handle changes
+		max_bw = OPUS_BANDWIDTH_FULLBAND;
+	} else {
+		max_bw = (opus_int32)max_bandwidth;
+	}
+	opus_encoder_ctl(encoder, OPUS_SET_MAX_BANDWIDTH(max_bw));
+	opus_encoder_ctl(encoder, OPUS_GET_LOOKAHEAD(&lookahead));
+	opus_encoder_ctl(encoder, OPUS_SET_COMPLEXITY(encoder_complexity));
+	opus_encoder_ctl(encoder, OPUS_SET_PACKET_LOSS_PERC(packet_loss_perc));
+
+	opus_int32 use_vbr = bitrate_mode == GodotOpus::BITRATE_CONSTANT ? 0 : 1;
+	opus_encoder_ctl(encoder, OPUS_SET_VBR(use_vbr));
+	// opus_encoder_ctl(encoder, OPUS_SET_VBR_CONSTRAINT(cvbr));
+
+	if (bitrate_mode == GodotOpus::BITRATE_VARIABLE_AUTO || bitrate_mode == GodotOpus::BITRATE_VARIABLE_BITRATE_MAX) {
+		opus_encoder_ctl(encoder, OPUS_SET_BITRATE(bitrate_mode));
+		opus_encoder_ctl(encoder, OPUS_GET_BITRATE(&bitrate_bps));
+	} else {
+		// manual or constant mode, use bps
+		opus_encoder_ctl(encoder, OPUS_SET_BITRATE(bitrate_bps));
+	}
+
+	opus_encoder_ctl(encoder, OPUS_SET_INBAND_FEC(inband_fec ? 1 : 0));
+	// opus_encoder_ctl(encoder, OPUS_SET_FORCE_CHANNELS(forcechannels));
+	opus_encoder_ctl(encoder, OPUS_SET_DTX(dtx ? 1 : 0));
+	if (dred_duration_ms > 0 && opus_encoder_ctl(encoder, OPUS_SET_DRED_DURATION(dred_duration_ms / 10)) != OPUS_OK) {
+		WARN_PRINT("OpusEncoderState dred_duration ignored, libopus was built without DRED support");
+	}
+	// opus_encoder_ctl(encoder, OPUS_SET_LSB_DEPTH(16));
+	// opus_encoder_ctl(encoder, OPUS_SET_EXPERT_FRAME_DURATION(variable_duration));
+
+	// Frames longer than 120 ms in total can't be put in one packet
+	const int max_frames = MAX(1, (int)sampling_rate * 120 / 1000 / frame_size);
+	packet_frames = frames_per_packet;
+	if (packet_frames > max_frames) {
+		WARN_PRINT("OpusEncoderState frames_per_packet exceeds 120 ms of audio, reducing it");
+		packet_frames = max_frames;
+	}
+	if (packet_frames > 1 && repacketizer == NULL) {
+		repacketizer = opus_repacketizer_create();
+		ERR_FAIL_NULL_V_MSG(repacketizer, false, "Failed to create Opus repacketizer");
+	}
+
+	// One slot per frame, then room for the joined packet (TOC, count, and frame lengths)
+	payload_bytes = max_payload_bytes;
+	encode_data.resize(packet_frames * payload_bytes + (packet_frames > 1 ? packet_frames * (payload_bytes + 2) + 2 : 0));
+	encode_pcm.resize(frame_size * (int)channels);
+	async_pcm.resize(frame_size * (int)channels);
+
+	input_resampler.setup(mix_rate > 0 ? mix_rate : (int)sampling_rate, (int)sampling_rate, (int)channels);
+	if (input_resampler.is_active()) {
+		push_pcm.resize(AudioResampler::BLOCK_FRAMES * (int)channels);
+		push_resampled.resize(input_resampler.get_max_output(AudioResampler::BLOCK_FRAMES) * (int)channels);
+	}
+
+	_initialize_buffer();
+
+	initialized = true;
+
+	if (!dnn_blob.is_empty()) {
+		_apply_dnn_blob();
+	}
+
+	return true;
+}
+
+void OpusEncoderState::release() {
+	_finish_encode_task();
+
+	initialized = false;
+
+	if (encoder != NULL) {
+		opus_encoder_destroy(encoder);
+		encoder = NULL;
+	}
+}
+
+bool OpusEncoderState::is_initialized() const {
+	return initialized;
+}
+
+void OpusEncoderState::_initialize_buffer() {
+	if (!buffer_initialized) {
+		float target_buffer_size = (int)sampling_rate * (int)channels * buffer_length_seconds;
+		ERR_FAIL_COND(target_buffer_size <= 0 || target_buffer_size >= (1 << 27));
+		encode_buffer.resize(nearest_shift((int)target_buffer_size));
+		buffer_initialized = true;
+	}
+
+	clear_buffer();
+}
+
+void OpusEncoderState::clear_buffer() {
+	// Reading from the buffer belongs to the encode task while it runs
+	_finish_encode_task();
+
+	const int32_t data_left = encode_buffer.data_left();
+	encode_buffer.advance_read(data_left);
+
+	// So do the input frames the resampler is still holding on to
+	input_resampler.reset();
+
+	// Frames of an unfinished packet go with the samples they came from
+	repacket_frames = 0;
+	if (repacketizer != NULL) {
+		opus_repacketizer_init(repacketizer);
+	}
+
+	MutexLock lock(*encode_mutex.ptr());
+	encoded_packets.clear();
+}
+
+bool OpusEncoderState::can_push_buffer(const int num_samples) const {
+	ERR_FAIL_COND_V(!buffer_initialized, false);
+	return encode_buffer.space_left() >= (input_resampler.get_max_output(num_samples) * (int)channels);
+}
+
+bool OpusEncoderState::push_buffer(const PackedVector2Array data) {
+	ERR_FAIL_COND_V_MSG(!buffer_initialized, false, "OpusEncoderState encode buffer not initialized");
+	if (input_resampler.is_active()) {
+		return _push_resampled(data.ptr(), NULL, data.size());
+	}
+	ERR_FAIL_COND_V_MSG(encode_buffer.space_left() < (data.size() * (int)channels), false, "OpusEncoderState encode buffer has insuffient space left");
+
+	// Convert straight into the ring; at most two contiguous runs when it wraps
+	const int ch = (int)channels;
+	const int samples = data.size() * ch;
+	float *first, *second;
+	int first_size, second_size;
+	int written = encode_buffer.write_spans(samples, first, first_size, second, second_size);
+
+	if (written == samples) {
+		const Vector2 *src = data.ptr();
+		int first_frames = first_size / ch;
+		_convert_frames(src, first, first_frames);
+		src += first_frames;
+
+		float *dst = second;
+		int remaining = data.size() - first_frames;
+		if (first_frames * ch != first_size) {
+			// Only possible for stereo after an odd push_buffer_raw; split that frame over the wrap
+			float frame[2];
+			_convert_frames(src++, frame, 1);
+			first[first_size - 1] = frame[0];
+			*dst++ = frame[1];
+			remaining--;
+		}
+		_convert_frames(src, dst, remaining);
+		encode_buffer.advance_write(samples);
+	}
+
+	if (async_encoding) {
+		_schedule_encode_task();
+	}
+
+	ERR_FAIL_COND_V_MSG(written != samples, false, "OpusEncoderState encode buffer failed to write");
+	return true;
+}
+
+bool OpusEncoderState::push_buffer_raw(const PackedFloat32Array data) {
+	ERR_FAIL_COND_V_MSG(!buffer_initialized, false, "OpusEncoderState encode buffer not initialized");
+	if (input_resampler.is_active()) {
+		return _push_resampled(NULL, data.ptr(), data.size() / (int)channels);
+	}
+	ERR_FAIL_COND_V_MSG(encode_buffer.space_left() < data.size(), false, "OpusEncoderState encode buffer has insuffient space left");
+
+	int written;
+	written = encode_buffer.write(data.ptr(), data.size());
+
+	if (async_encoding) {
+		_schedule_encode_task();
+	}
+
+	if (written != data.size()) {
+		WARN_PRINT("OpusEncoderState push_buffer_raw did not write all samples to encode_buffer");
+		return false;
+	}
+	return true;
+}
+
+bool OpusEncoderState::_push_resampled(const Vector2 *frames, const float *samples, const int count) {
+	// Converts mix_rate input a block at a time. Frames come either as Vector2
+	// (converted to the channel layout first) or as already interleaved samples.
+	const int ch = (int)channels;
+	ERR_FAIL_COND_V_MSG(encode_buffer.space_left() < input_resampler.get_max_output(count) * ch, false, "OpusEncoderState encode buffer has insuffient space left");
+
+	int done = 0;
+	while (done < count) {
+		const int block = MIN(count - done, AudioResampler::BLOCK_FRAMES);
+		const float *src;
+		if (frames != NULL) {
+			_convert_frames(frames + done, push_pcm.ptr(), block);
+			src = push_pcm.ptr();
+		} else {
+			src = samples + done * ch;
+		}
+		const int produced = input_resampler.process(src, block, push_resampled.ptr());
+		encode_buffer.write(push_resampled.ptr(), produced * ch);
+		done += block;
+	}
+
+	if (async_encoding) {
+		_schedule_encode_task();
+	}
+	return true;
+}
+
+bool OpusEncoderState::has_encoded_packet() const {
+	ERR_FAIL_COND_V(!buffer_initialized, false);
+	if (async_encoding) {
+		// Encoding happens in the background; report on finished packets instead.
+		return get_queued_packet_count() > 0;
+	}
+	return encode_buffer.data_left() >= _packet_samples_needed();
+}
+
+PackedByteArray OpusEncoderState::get_encoded_packet() {
+	ERR_FAIL_COND_V_MSG(!initialized, PackedByteArray(), "OpusEncoderState not initialized");
+	if (async_encoding) {
+		return pop_encoded_packet();
+	}
+	if (!has_encoded_packet()) {
+		return PackedByteArray();
+	}
+
+	return _encode_packet(encode_pcm);
+}
+
+Array OpusEncoderState::get_encoded_packets(const int max_packets) {
+	ERR_FAIL_COND_V_MSG(!initialized, Array(), "OpusEncoderState not initialized");
+
+	Array ret;
+	if (async_encoding) {
+		{
+			MutexLock lock(*encode_mutex.ptr());
+			while (!encoded_packets.is_empty() && (max_packets < 0 || ret.size() < max_packets)) {
+				ret.push_back(encoded_packets.front()->get());
+				encoded_packets.pop_front();
+			}
+		}
+		_schedule_encode_task();
+		return ret;
+	}
+
+	while (has_encoded_packet() && (max_packets < 0 || ret.size() < max_packets)) {
+		PackedByteArray packet = _encode_packet(encode_pcm);
+		if (packet.is_empty()) {
+			break;
+		}
+		ret.push_back(packet);
+	}
+	return ret;
+}
+
+PackedByteArray OpusEncoderState::pop_encoded_packet() {
+	ERR_FAIL_COND_V_MSG(!initialized, PackedByteArray(), "OpusEncoderState not initialized");
+	ERR_FAIL_COND_V_MSG(!async_encoding, PackedByteArray(), "OpusEncoderState pop_encoded_packet requires async_encoding");
+
+	PackedByteArray ret;
+	{
+		MutexLock lock(*encode_mutex.ptr());
+		if (!encoded_packets.is_empty()) {
+			ret = encoded_packets.front()->get();
+			encoded_packets.pop_front();
+		}
+	}
+
+	// Catch any frames pushed after the last task stopped looking for work.
+	_schedule_encode_task();
+	return ret;
+}
+
+int OpusEncoderState::get_queued_packet_count() const {
+	MutexLock lock(*encode_mutex.ptr());
+	return encoded_packets.size();
+}
+
+bool OpusEncoderState::is_in_dtx() const {
+	ERR_FAIL_COND_V_MSG(!initialized, false, "OpusEncoderState not initialized");
+
+	opus_int32 in_dtx = 0;
+	MutexLock lock(*encoder_mutex.ptr());
+	opus_encoder_ctl(encoder, OPUS_GET_IN_DTX(&in_dtx));
+	return in_dtx != 0;
+}
+
+bool OpusEncoderState::load_dnn_blob(const PackedByteArray &blob) {
+	ERR_FAIL_COND_V_MSG(blob.is_empty(), false, "DNN blob is empty");
+	// Sharing one blob between states keeps a single copy of the weights in memory
+	dnn_blob = blob;
+	if (!initialized) {
+		return true;
+	}
+	MutexLock lock(*encoder_mutex.ptr());
+	return _apply_dnn_blob();
+}
+
+void OpusEncoderState::set_signal_owner(Object *p_owner) {
+	signal_owner = p_owner != NULL ? p_owner : this;
+}
+
+// Protected internal methods ///////////////////////////////////////////////
+
+PackedByteArray OpusEncoderState::_encode_packet(PackedFloat32Array &pcm) {
+	// Encodes a single frame off the front of encode_buffer. Only the consumer
+	// side of the buffer is touched, so this may run while another thread pushes.
+	// The frame is encoded in place when it doesn't wrap around the ring, otherwise
+	// it's copied into the persistent pcm scratch buffer; neither path allocates.
+	const int frame_samples = frame_size * (int)channels;
+	if (pcm.size() != frame_samples) {
+		pcm.resize(frame_samples);
+	}
+
+	// The task encodes each frame as it arrives; a repacketized packet in
+	// progress waits in encode_data for the rest
+	if (async_encoding && encode_buffer.data_left() < frame_samples) {
+		return PackedByteArray();
+	}
+
+	// Held through the repacketized path too; the dynamic setters take it
+	MutexLock lock(*encoder_mutex.ptr());
+
+	if (packet_frames > 1) {
+		return _encode_repacketized(pcm);
+	}
+
+	const float *frame = _read_frame(pcm, frame_samples);
+	ERR_FAIL_NULL_V_MSG(frame, PackedByteArray(), "Failed to read frame samples from encode_buffer");
+
+	opus_int32 encoded_length = opus_encode_float(encoder, frame, frame_size, encode_data.ptrw(), payload_bytes);
+
+	ERR_FAIL_COND_V_MSG(encoded_length < 0, PackedByteArray(), opus_strerror(encoded_length));
+
+	const uint8_t *encoded = encode_data.ptr();
+	int num_encoded = opus_packet_get_samples_per_frame(encoded, (int)sampling_rate) * opus_packet_get_nb_frames(encoded, encoded_length);
+
+	// Only release the samples once encoding is done, the frame may point into the ring
+	encode_buffer.advance_read(num_encoded * (int)channels);
+
+	encoded_packet.resize(encoded_length);
+	memcpy(encoded_packet.ptrw(), encoded, encoded_length);
+	return encoded_packet;
+}
+
+PackedByteArray OpusEncoderState::_encode_repacketized(PackedFloat32Array &pcm) {
+	// Encodes frames one at a time into their encode_data slots and joins them
+	// with the repacketizer. Frames already encoded for the packet in progress
+	// are kept, so this can resume after running out of samples.
+	const int frame_samples = frame_size * (int)channels;
+	uint8_t *slots = encode_data.ptrw();
+
+	while (repacket_frames < packet_frames) {
+		if (encode_buffer.data_left() < frame_samples) {
+			return PackedByteArray();
+		}
+
+		const float *frame = _read_frame(pcm, frame_samples);
+		ERR_FAIL_NULL_V_MSG(frame, PackedByteArray(), "Failed to read frame samples from encode_buffer");
+
+		uint8_t *frame_data = slots + repacket_frames * payload_bytes;
+		opus_int32 encoded_length = opus_encode_float(encoder, frame, frame_size, frame_data, payload_bytes);
+		encode_buffer.advance_read(frame_samples);
+
+		ERR_FAIL_COND_V_MSG(encoded_length < 0, PackedByteArray(), opus_strerror(encoded_length));
+
+		if (opus_repacketizer_cat(repacketizer, frame_data, encoded_length) != OPUS_OK) {
+			ERR_FAIL_COND_V_MSG(repacket_frames == 0, PackedByteArray(), "Opus repacketizer rejected an encoded frame");
+			// The encoder changed mode or bandwidth, which can't share a packet. Send
+			// the frames so far, and start the next packet with this one.
+			PackedByteArray ret = _flush_repacketizer();
+			memmove(slots, frame_data, encoded_length);
+			opus_repacketizer_cat(repacketizer, slots, encoded_length);
+			repacket_frames = 1;
+			return ret;
+		}
+		repacket_frames++;
+	}
+
+	return _flush_repacketizer();
+}
+
+PackedByteArray OpusEncoderState::_flush_repacketizer() {
+	uint8_t *out = encode_data.ptrw() + packet_frames * payload_bytes;
+	const int out_size = encode_data.size() - packet_frames * payload_bytes;
+	opus_int32 packet_length = opus_repacketizer_out(repacketizer, out, out_size);
+
+	opus_repacketizer_init(repacketizer);
+	repacket_frames = 0;
+
+	ERR_FAIL_COND_V_MSG(packet_length < 0, PackedByteArray(), opus_strerror(packet_length));
+
+	encoded_packet.resize(packet_length);
+	memcpy(encoded_packet.ptrw(), out, packet_length);
+	return encoded_packet;
+}
+
+int OpusEncoderState::_packet_samples_needed() const {
+	return frame_size * (int)channels * (packet_frames - repacket_frames);
+}
+
+void OpusEncoderState::_convert_frames(const Vector2 *src, float *dst, const int frames) const {
+	if (channels == GodotOpus::CHANNELS_STEREO) {
+		// Interleave the two channels
+		AudioKernels::interleave_stereo(src, dst, frames);
+	} else {
+		// Average the two channels
+		AudioKernels::downmix_mono(src, dst, frames);
+	}
+}
+
+const float *OpusEncoderState::_read_frame(PackedFloat32Array &pcm, const int frame_samples) {
+	const float *frame = encode_buffer.read_ptr(frame_samples);
+	if (frame != nullptr) {
+		return frame;
+	}
+
+	int len = encode_buffer.read(pcm.ptrw(), frame_samples, false);
+	return len == frame_samples ? pcm.ptr() : nullptr;
+}
+
+void OpusEncoderState::_schedule_encode_task() {
+	if (!async_encoding || !initialized) {
+		return;
+	}
+
+	// Only a whole frame is checked for here. How many more a packet needs
+	// depends on repacket_frames, which belongs to the task while it runs.
+	if (encode_buffer.data_left() < frame_size * (int)channels) {
+		return;
+	}
+
+	// A task is running and hasn't yet retired this request, so it will encode
+	// the new frames before it exits.
+	if (encode_requests.postincrement() > 0) {
+		return;
+	}
+
+	// The previous task retired every request, it's done or about to return
+	WorkerThreadPool *pool = WorkerThreadPool::get_singleton();
+	if (encode_task_id >= 0) {
+		pool->wait_for_task_completion(encode_task_id);
+	}
+	encode_task_id = pool->add_task(Callable(this, "_encode_task"), false, "OpusEncoderState encode");
+}
+
+void OpusEncoderState::_finish_encode_task() {
+	if (encode_task_id >= 0) {
+		WorkerThreadPool::get_singleton()->wait_for_task_completion(encode_task_id);
+		encode_task_id = -1;
+	}
+}
+
+void OpusEncoderState::_encode_task() {
+	// Runs on a WorkerThreadPool thread; encodes every complete frame on the buffer.
+	uint32_t requests = encode_requests.get();
+	while (true) {
+		while (true) {
+			PackedByteArray packet = _encode_packet(async_pcm);
+			if (packet.is_empty()) {
+				break;
+			}
+
+			{
+				MutexLock lock(*encode_mutex.ptr());
+				encoded_packets.push_back(packet);
+			}
+
+			if (!dispatch_pending.is_set()) {
+				dispatch_pending.set();
+				call_deferred("_dispatch_encoded_packets");
+			}
+		}
+
+		// Frames pushed after the count was read may not have been seen, go again.
+		// Once it drops to 0 the next push starts a new task.
+		if (encode_requests.sub(requests) == 0) {
+			break;
+		}
+		requests = encode_requests.get();
+	}
+}
+
+void OpusEncoderState::_dispatch_encoded_packets() {
+	// Main thread; only drains the queue when someone is listening for packet_encoded.
+	dispatch_pending.clear();
+	if (signal_owner->get_signal_connection_list("packet_encoded").is_empty()) {
+		return;
+	}
+
+	while (true) {
+		PackedByteArray packet = pop_encoded_packet();
+		if (packet.is_empty()) {
+			break;
+		}
+		signal_owner->emit_signal("packet_encoded", packet);
+	}
+}
+
+bool OpusEncoderState::_apply_dnn_blob() {
+	// libopus points into the blob rather than copying it, so dnn_blob has to
+	// outlive the encoder. It only takes a blob when built with
+	// USE_WEIGHTS_FILE, and reports OPUS_UNIMPLEMENTED otherwise.
+	int ret = opus_encoder_ctl(encoder, OPUS_SET_DNN_BLOB(dnn_blob.ptr(), dnn_blob.size()));
+	ERR_FAIL_COND_V_MSG(ret == OPUS_UNIMPLEMENTED, false, "Failed to load DNN blob, libopus built without USE_WEIGHTS_FILE");
+	ERR_FAIL_COND_V_MSG(ret != OPUS_OK, false, "Failed to load DNN blob, it may not match this version of libopus");
+	return true;
+}
+
+void OpusEncoderState::_update_frame_size() {
+	frame_size = GodotOpus::calculate_frame_size((int)sampling_rate, frame_duration);
+}
+
+// Getters and Setters ////////////////////////////////////////////////////////
+
+void OpusEncoderState::set_sampling_rate(const GodotOpus::SampleRate p_sampling_rate) {
+	sampling_rate = p_sampling_rate;
+	_update_frame_size();
+}
+
+GodotOpus::SampleRate OpusEncoderState::get_sampling_rate() const {
+	return sampling_rate;
+}
+
+void OpusEncoderState::set_channels(const GodotOpus::Channels p_channels) {
+	channels = p_channels;
+}
+
+GodotOpus::Channels OpusEncoderState::get_channels() const {
+	return channels;
+}
+
+void OpusEncoderState::set_application_mode(const GodotOpus::ApplicationMode p_application_mode) {
+	application_mode = p_application_mode;
+}
+
+GodotOpus::ApplicationMode OpusEncoderState::get_application_mode() const {
+	return application_mode;
+}
+
+void OpusEncoderState::set_max_payload_bytes(const int p_max_payload_bytes) {
+	max_payload_bytes = p_max_payload_bytes;
+}
+
+int OpusEncoderState::get_max_payload_bytes() const {
+	return max_payload_bytes;
+}
+
+void OpusEncoderState::set_buffer_length_seconds(const float p_buffer_length_seconds) {
+	buffer_length_seconds = p_buffer_length_seconds;
+}
+
+float OpusEncoderState::get_buffer_length_seconds() const {
+	return buffer_length_seconds;
+}
+
+void OpusEncoderState::set_frame_duration(const GodotOpus::FrameSizeDuration p_frame_duration) {
+	frame_duration = p_frame_duration;
+	_update_frame_size();
+}
+
+GodotOpus::FrameSizeDuration OpusEncoderState::get_frame_duration() const {
+	return frame_duration;
+}
+
+int OpusEncoderState::get_frame_size() const {
+	return frame_size;
+}
+
+int OpusEncoderState::get_lookahead() const {
+	return lookahead;
+}
+
+void OpusEncoderState::set_bandwidth(const GodotOpus::Bandwidth p_bandwidth) {
+	bandwidth = p_bandwidth;
+}
+
+GodotOpus::Bandwidth OpusEncoderState::get_bandwidth() const {
+	return bandwidth;
+}
+
+void OpusEncoderState::set_max_bandwidth(const GodotOpus::Bandwidth p_bandwidth) {
+	max_bandwidth = p_bandwidth;
+}
+
+GodotOpus::Bandwidth OpusEncoderState::get_max_bandwidth() const {
+	return max_bandwidth;
+}
+
+void OpusEncoderState::set_encoder_complexity(const int p_complexity) {
+	encoder_complexity = p_complexity;
+}
+
+int OpusEncoderState::get_encoder_complexity() const {
+	return encoder_complexity;
+}
+
+void OpusEncoderState::set_async_encoding(const bool p_async_encoding) {
+	if (async_encoding == p_async_encoding) {
+		return;
+	}
+	_finish_encode_task();
+	async_encoding = p_async_encoding;
+}
+
+bool OpusEncoderState::is_async_encoding() const {
+	return async_encoding;
+}
+
+void OpusEncoderState::set_frames_per_packet(const int p_frames_per_packet) {
+	ERR_FAIL_COND_MSG(p_frames_per_packet < 1 || p_frames_per_packet > 48, "frames_per_packet must be between 1 and 48");
+	frames_per_packet = p_frames_per_packet;
+}
+
+int OpusEncoderState::get_frames_per_packet() const {
+	return frames_per_packet;
+}
+
+void OpusEncoderState::set_mix_rate(const int p_mix_rate) {
+	ERR_FAIL_COND_MSG(p_mix_rate < 0 || p_mix_rate > 192000, "mix_rate outside valid range 0-192000");
+	mix_rate = p_mix_rate;
+}
+
+int OpusEncoderState::get_mix_rate() const {
+	return mix_rate;
+}
+
+// Dynamic properties (don't require re-initialize() to be applied)
+
+void OpusEncoderState::set_bitrate_mode(const GodotOpus::BitrateMode p_mode) {
+	bitrate_mode = p_mode;
+
+	if (initialized) {
+		MutexLock lock(*encoder_mutex.ptr());
+		opus_int32 use_vbr = bitrate_mode == GodotOpus::BITRATE_CONSTANT ? 0 : 1;
+		opus_encoder_ctl(encoder, OPUS_SET_VBR(use_vbr));
+
+		if (bitrate_mode == GodotOpus::BITRATE_VARIABLE_AUTO || bitrate_mode == GodotOpus::BITRATE_VARIABLE_BITRATE_MAX) {
+			opus_encoder_ctl(encoder, OPUS_SET_BITRATE(bitrate_mode));
+			opus_encoder_ctl(encoder, OPUS_GET_BITRATE(&bitrate_bps));
+		} else {
+			// manual or constant mode, use bps
+			opus_encoder_ctl(encoder, OPUS_SET_BITRATE(bitrate_bps));
+		}
+	}
+}
+
+GodotOpus::BitrateMode OpusEncoderState::get_bitrate_mode() const {
+	return bitrate_mode;
+}
+
+void OpusEncoderState::set_bitrate(const int p_bitrate) {
+	bitrate_bps = p_bitrate;
+
+	if (initialized) {
+		MutexLock lock(*encoder_mutex.ptr());
+		if (bitrate_mode == GodotOpus::BITRATE_VARIABLE_AUTO || bitrate_mode == GodotOpus::BITRATE_VARIABLE_BITRATE_MAX) {
+			WARN_PRINT_ONCE_ED("Bitrate value ignored when Bitrate Mode is Auto or Max");
+			opus_encoder_ctl(encoder, OPUS_GET_BITRATE(&bitrate_bps));
+		} else {
+			// manual or constant mode, use bps
+			bitrate_bps = p_bitrate;
+			opus_encoder_ctl(encoder, OPUS_SET_BITRATE(bitrate_bps));
+		}
+	}
+}
+
+int OpusEncoderState::get_bitrate() const {
+	return bitrate_bps;
+}
+
+void OpusEncoderState::set_packet_loss_perc(const int p_packet_loss_perc) {
+	ERR_FAIL_COND_MSG(p_packet_loss_perc < 0 || p_packet_loss_perc > 100, "packet_loss outside valid range 0-100");
+	packet_loss_perc = p_packet_loss_perc;
+	if (initialized) {
+		MutexLock lock(*encoder_mutex.ptr());
+		opus_encoder_ctl(encoder, OPUS_SET_PACKET_LOSS_PERC(packet_loss_perc));
+	}
+}
+
+int OpusEncoderState::get_packet_loss_perc() const {
+	return packet_loss_perc;
+}
+
+void OpusEncoderState::set_inband_fec(const bool p_inband_fec) {
+	inband_fec = p_inband_fec;
+	if (initialized) {
+		MutexLock lock(*encoder_mutex.ptr());
+		opus_encoder_ctl(encoder, OPUS_SET_INBAND_FEC(inband_fec ? 1 : 0));
+	}
+}
+
+bool OpusEncoderState::is_inband_fec() const {
+	return inband_fec;
+}
+
+void OpusEncoderState::set_dtx(const bool p_dtx) {
+	dtx = p_dtx;
+	if (initialized) {
+		MutexLock lock(*encoder_mutex.ptr());
+		opus_encoder_ctl(encoder, OPUS_SET_DTX(dtx ? 1 : 0));
+	}
+}
+
+bool OpusEncoderState::is_dtx() const {
+	return dtx;
+}
+
+void OpusEncoderState::set_dred_duration_ms(const int p_dred_duration_ms) {
+	ERR_FAIL_COND_MSG(p_dred_duration_ms < 0 || p_dred_duration_ms > 1040, "dred_duration outside valid range 0-1040 ms");
+	dred_duration_ms = p_dred_duration_ms;
+	if (initialized) {
+		MutexLock lock(*encoder_mutex.ptr());
+		opus_encoder_ctl(encoder, OPUS_SET_DRED_DURATION(dred_duration_ms / 10));
+	}
+}
+
+int OpusEncoderState::get_dred_duration_ms() const {
+	return dred_duration_ms;
+}
+
+// Bind methods
+
+void OpusEncoderState::_bind_methods() {
+	ClassDB::bind_method(D_METHOD("initialize"), &OpusEncoderState::initialize);
+	ClassDB::bind_method(D_METHOD("release"), &OpusEncoderState::release);
+	ClassDB::bind_method(D_METHOD("is_initialized"), &OpusEncoderState::is_initialized);
+	ClassDB::bind_method(D_METHOD("get_frame_size"), &OpusEncoderState::get_frame_size);
+	ClassDB::bind_method(D_METHOD("get_lookahead"), &OpusEncoderState::get_lookahead);
+
+	ClassDB::bind_method(D_METHOD("clear_buffer"), &OpusEncoderState::clear_buffer);
+	ClassDB::bind_method(D_METHOD("can_push_buffer", "num_samples"), &OpusEncoderState::can_push_buffer);
+	ClassDB::bind_method(D_METHOD("push_buffer", "data"), &OpusEncoderState::push_buffer);
+	ClassDB::bind_method(D_METHOD("push_buffer_raw", "data"), &OpusEncoderState::push_buffer_raw);
+	ClassDB::bind_method(D_METHOD("has_encoded_packet"), &OpusEncoderState::has_encoded_packet);
+	ClassDB::bind_method(D_METHOD("get_encoded_packet"), &OpusEncoderState::get_encoded_packet);
+	ClassDB::bind_method(D_METHOD("get_encoded_packets", "max_packets"), &OpusEncoderState::get_encoded_packets, DEFVAL(-1));
+	ClassDB::bind_method(D_METHOD("pop_encoded_packet"), &OpusEncoderState::pop_encoded_packet);
+	ClassDB::bind_method(D_METHOD("get_queued_packet_count"), &OpusEncoderState::get_queued_packet_count);
+	ClassDB::bind_method(D_METHOD("_encode_task"), &OpusEncoderState::_encode_task);
+	ClassDB::bind_method(D_METHOD("_dispatch_encoded_packets"), &OpusEncoderState::_dispatch_encoded_packets);
+
+	ClassDB::bind_method(D_METHOD("is_in_dtx"), &OpusEncoderState::is_in_dtx);
+	ClassDB::bind_method(D_METHOD("load_dnn_blob", "blob"), &OpusEncoderState::load_dnn_blob);
+
+	ClassDB::bind_method(D_METHOD("get_sampling_rate"), &OpusEncoderState::get_sampling_rate);
+	ClassDB::bind_method(D_METHOD("set_sampling_rate", "p_sampling_rate"), &OpusEncoderState::set_sampling_rate);
+	ClassDB::bind_method(D_METHOD("get_channels"), &OpusEncoderState::get_channels);
+	ClassDB::bind_method(D_METHOD("set_channels", "p_channels"), &OpusEncoderState::set_channels);
+	ClassDB::bind_method(D_METHOD("get_application_mode"), &OpusEncoderState::get_application_mode);
+	ClassDB::bind_method(D_METHOD("set_application_mode", "p_application_mode"), &OpusEncoderState::set_application_mode);
+
+	ClassDB::bind_method(D_METHOD("get_frame_duration"), &OpusEncoderState::get_frame_duration);
+	ClassDB::bind_method(D_METHOD("set_frame_duration", "p_frame_duration"), &OpusEncoderState::set_frame_duration);
+	ClassDB::bind_method(D_METHOD("get_bandwidth"), &OpusEncoderState::get_bandwidth);
+	ClassDB::bind_method(D_METHOD("set_bandwidth", "p_bandwidth"), &OpusEncoderState::set_bandwidth);
+	ClassDB::bind_method(D_METHOD("get_max_bandwidth"), &OpusEncoderState::get_max_bandwidth);
+	ClassDB::bind_method(D_METHOD("set_max_bandwidth", "p_bandwidth"), &OpusEncoderState::set_max_bandwidth);
+
+	ClassDB::bind_method(D_METHOD("get_bitrate_mode"), &OpusEncoderState::get_bitrate_mode);
+	ClassDB::bind_method(D_METHOD("set_bitrate_mode", "p_mode"), &OpusEncoderState::set_bitrate_mode);
+	ClassDB::bind_method(D_METHOD("get_bitrate"), &OpusEncoderState::get_bitrate);
+	ClassDB::bind_method(D_METHOD("set_bitrate", "p_bitrate"), &OpusEncoderState::set_bitrate);
+
+	ClassDB::bind_method(D_METHOD("get_encoder_complexity"), &OpusEncoderState::get_encoder_complexity);
+	ClassDB::bind_method(D_METHOD("set_encoder_complexity", "p_complexity"), &OpusEncoderState::set_encoder_complexity);
+	ClassDB::bind_method(D_METHOD("get_packet_loss_perc"), &OpusEncoderState::get_packet_loss_perc);
+	ClassDB::bind_method(D_METHOD("set_packet_loss_perc", "p_packet_loss"), &OpusEncoderState::set_packet_loss_perc);
+	ClassDB::bind_method(D_METHOD("is_inband_fec"), &OpusEncoderState::is_inband_fec);
+	ClassDB::bind_method(D_METHOD("set_inband_fec", "p_inband_fec"), &OpusEncoderState::set_inband_fec);
+	ClassDB::bind_method(D_METHOD("is_dtx"), &OpusEncoderState::is_dtx);
+	ClassDB::bind_method(D_METHOD("set_dtx", "p_dtx"), &OpusEncoderState::set_dtx);
+	ClassDB::bind_method(D_METHOD("get_dred_duration_ms"), &OpusEncoderState::get_dred_duration_ms);
+	ClassDB::bind_method(D_METHOD("set_dred_duration_ms", "p_dred_duration_ms"), &OpusEncoderState::set_dred_duration_ms);
+
+	ClassDB::bind_method(D_METHOD("is_async_encoding"), &OpusEncoderState::is_async_encoding);
+	ClassDB::bind_method(D_METHOD("set_async_encoding", "p_async_encoding"), &OpusEncoderState::set_async_encoding);
+	ClassDB::bind_method(D_METHOD("get_frames_per_packet"), &OpusEncoderState::get_frames_per_packet);
+	ClassDB::bind_method(D_METHOD("set_frames_per_packet", "p_frames_per_packet"), &OpusEncoderState::set_frames_per_packet);
+	ClassDB::bind_method(D_METHOD("get_mix_rate"), &OpusEncoderState::get_mix_rate);
+	ClassDB::bind_method(D_METHOD("set_mix_rate", "p_mix_rate"), &OpusEncoderState::set_mix_rate);
+
+	ClassDB::bind_method(D_METHOD("get_max_payload_bytes"), &OpusEncoderState::get_max_payload_bytes);
+	ClassDB::bind_method(D_METHOD("set_max_payload_bytes", "p_max_payload_bytes"), &OpusEncoderState::set_max_payload_bytes);
+	ClassDB::bind_method(D_METHOD("get_buffer_length_seconds"), &OpusEncoderState::get_buffer_length_seconds);
+	ClassDB::bind_method(D_METHOD("set_buffer_length_seconds", "p_buffer_length_seconds"), &OpusEncoderState::set_buffer_length_seconds);
+
+	ClassDB::add_property("OpusEncoderState", PropertyInfo(Variant::INT, "sampling_rate", PROPERTY_HINT_ENUM, "8 kHz:8000,12 kHz:12000,16 kHz:16000,24 kHz:24000,48 kHz:48000"), "set_sampling_rate", "get_sampling_rate");
+	ClassDB::add_property("OpusEncoderState", PropertyInfo(Variant::INT, "channels", PROPERTY_HINT_ENUM, "Mono:1,Stereo:2"), "set_channels", "get_channels");
+	ClassDB::add_property("OpusEncoderState", PropertyInfo(Variant::INT, "application_mode", PROPERTY_HINT_ENUM, "VoIP:2048,Audio:2049,Restricted-LowDelay:2051"), "set_application_mode", "get_application_mode");
+	ClassDB::add_property("OpusEncoderState", PropertyInfo(Variant::INT, "frame_duration", PROPERTY_HINT_ENUM, "2.5 ms:5001,5 ms:5002,10 ms:5003,20 ms:5004,40 ms:5005,60 ms:5006,80 ms:5007,100 ms:5008,120 ms:5009"), "set_frame_duration", "get_frame_duration");
+	ClassDB::add_property("OpusEncoderState", PropertyInfo(Variant::INT, "bandwidth", PROPERTY_HINT_ENUM, "Narrow Band:1101,Medium Band:1102,Wide Band:1103,Super Wide Band:1004,Full Band:1105,Auto Bandwidth:-1000"), "set_bandwidth", "get_bandwidth");
+	ClassDB::add_property("OpusEncoderState", PropertyInfo(Variant::INT, "max_bandwidth", PROPERTY_HINT_ENUM, "Narrow Band:1101,Medium Band:1102,Wide Band:1103,Super Wide Band:1004,Full Band:1105"), "set_max_bandwidth", "get_max_bandwidth");
+	ClassDB::add_property("OpusEncoderState", PropertyInfo(Variant::INT, "bitrate_mode", PROPERTY_HINT_ENUM, "VBR Auto:-1000,VBR Max:-1,VBR Manual:0,CBR:1"), "set_bitrate_mode", "get_bitrate_mode");
+	ClassDB::add_property("OpusEncoderState", PropertyInfo(Variant::INT, "bitrate", PROPERTY_HINT_RANGE, "6000,512000,1000,exp,suffix:bps"), "set_bitrate", "get_bitrate");
+	ClassDB::add_property("OpusEncoderState", PropertyInfo(Variant::INT, "encoder_complexity", PROPERTY_HINT_RANGE, "0,10,1"), "set_encoder_complexity", "get_encoder_complexity");
+	ClassDB::add_property("OpusEncoderState", PropertyInfo(Variant::INT, "packet_loss", PROPERTY_HINT_RANGE, "0,100,1,suffix:%"), "set_packet_loss_perc", "get_packet_loss_perc");
+	ClassDB::add_property("OpusEncoderState", PropertyInfo(Variant::BOOL, "inband_fec"), "set_inband_fec", "is_inband_fec");
+	ClassDB::add_property("OpusEncoderState", PropertyInfo(Variant::BOOL, "dtx"), "set_dtx", "is_dtx");
+	ClassDB::add_property("OpusEncoderState", PropertyInfo(Variant::INT, "dred_duration", PROPERTY_HINT_RANGE, "0,1040,10,suffix:ms"), "set_dred_duration_ms", "get_dred_duration_ms");
+	ClassDB::add_property("OpusEncoderState", PropertyInfo(Variant::INT, "frames_per_packet", PROPERTY_HINT_RANGE, "1,48,1"), "set_frames_per_packet", "get_frames_per_packet");
+	ClassDB::add_property("OpusEncoderState", PropertyInfo(Variant::INT, "mix_rate", PROPERTY_HINT_RANGE, "0,192000,1,suffix:Hz"), "set_mix_rate", "get_mix_rate");
+	ClassDB::add_property("OpusEncoderState", PropertyInfo(Variant::INT, "max_payload_bytes", PROPERTY_HINT_RANGE, "16,2048,16,suffix:B"), "set_max_payload_bytes", "get_max_payload_bytes");
+	ClassDB::add_property("OpusEncoderState", PropertyInfo(Variant::FLOAT, "buffer_length_seconds", PROPERTY_HINT_RANGE, "0.01,10,0.01,exp,suffix:s"), "set_buffer_length_seconds", "get_buffer_length_seconds");
+	ClassDB::add_property("OpusEncoderState", PropertyInfo(Variant::BOOL, "async_encoding"), "set_async_encoding", "is_async_encoding");
+
+	ADD_SIGNAL(MethodInfo("packet_encoded", PropertyInfo(Variant::PACKED_BYTE_ARRAY, "packet")));
+}
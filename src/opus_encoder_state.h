@@ -0,0 +1,218 @@
+#ifndef OPUS_ENCODER_STATE_H
+#define OPUS_ENCODER_STATE_H
+
+#include <opus.h>
+#include <godot_cpp/classes/mutex.hpp>
+#include <godot_cpp/classes/ref_counted.hpp>
+#include <godot_cpp/templates/list.hpp>
+#include <godot_cpp/templates/local_vector.hpp>
+#include <godot_cpp/templates/safe_refcount.hpp>
+
+#include "audio_resampler.h"
+#include "godot_opus.h"
+#include "spsc_ring_buffer.h"
+
+namespace godot {
+
+// An Opus encoder and its input buffer, without the scene tree. GodotOpus wraps
+// one; on its own it can be kept in an array per stream (e.g. on a server
+// encoding hundreds of voices) and used from any thread. Each state must only
+// be used by one thread at a time, except that with async_encoding pushing and
+// the dynamic properties may be used while the encoding runs on another thread.
+class OpusEncoderState : public RefCounted {
+	GDCLASS(OpusEncoderState, RefCounted)
+
+	OpusEncoder *encoder;
+	OpusRepacketizer *repacketizer;
+
+	bool initialized;
+	bool buffer_initialized;
+
+	SpscRingBuffer<float> encode_buffer;
+	PackedFloat32Array encode_pcm;
+	PackedByteArray encode_data;
+
+	// Returned packets are written into this, sharing the buffer with the caller.
+	// The next encode only reuses it if that packet was dropped by then (e.g.
+	// put_packet(get_encoded_packet())); packets still referenced, such as in the
+	// array get_encoded_packets() returns or the async queue, are copied first.
+	// It belongs to the encode task with async_encoding.
+	PackedByteArray encoded_packet;
+
+	GodotOpus::SampleRate sampling_rate;
+	GodotOpus::Channels channels;
+	GodotOpus::ApplicationMode application_mode;
+	GodotOpus::FrameSizeDuration frame_duration;
+	GodotOpus::Bandwidth bandwidth;
+	GodotOpus::Bandwidth max_bandwidth;
+
+	int max_payload_bytes;
+	// max_payload_bytes as applied by initialize(), which encode_data is sized for
+	int payload_bytes;
+	int frame_size;
+	// Encoder delay, which the decoder drops from the start of the stream
+	int lookahead;
+
+	// Rate of the audio pushed, when it isn't sampling_rate (e.g. the
+	// AudioServer mix rate). push_pcm and push_resampled are pusher-side scratch.
+	int mix_rate;
+	AudioResampler input_resampler;
+	LocalVector<float> push_pcm;
+	LocalVector<float> push_resampled;
+
+	// Encoded frames joined into each packet; packet_frames is the count applied
+	// by initialize(). The frames of a packet in progress stay in encode_data
+	// (one payload_bytes slot each) until it's complete. With async_encoding
+	// repacket_frames is only touched by the encode task.
+	int frames_per_packet;
+	int packet_frames;
+	int repacket_frames;
+
+	GodotOpus::BitrateMode bitrate_mode;
+	int bitrate_bps;
+	int encoder_complexity;
+	int packet_loss_perc;
+	bool inband_fec;
+	bool dtx;
+	int dred_duration_ms;
+
+	// Weights for the DNN features (DRED), if not built in
+	PackedByteArray dnn_blob;
+
+	float buffer_length_seconds;
+
+	// Async encoding state. encode_buffer is lock-free (pushing thread writes,
+	// encode task reads); encode_mutex only guards the encoded_packets queue,
+	// and encoder_mutex the encoder itself, which the setters below reconfigure
+	// while the task may be encoding. encode_requests counts the pushes the
+	// task hasn't caught up with; the push that raises it from 0 starts the task.
+	bool async_encoding;
+	int64_t encode_task_id;
+	SafeNumeric<uint32_t> encode_requests;
+	SafeFlag dispatch_pending;
+	Ref<Mutex> encode_mutex;
+	Ref<Mutex> encoder_mutex;
+	List<PackedByteArray> encoded_packets;
+	PackedFloat32Array async_pcm;
+
+	// Object that emits packet_encoded, this state unless a GodotOpus wraps it
+	Object *signal_owner;
+
+protected:
+	static void _bind_methods();
+
+	void _initialize_buffer();
+	PackedByteArray _encode_packet(PackedFloat32Array &pcm);
+	PackedByteArray _encode_repacketized(PackedFloat32Array &pcm);
+	PackedByteArray _flush_repacketizer();
+	int _packet_samples_needed() const;
+	const float *_read_frame(PackedFloat32Array &pcm, const int frame_samples);
+	void _convert_frames(const Vector2 *src, float *dst, const int frames) const;
+	bool _push_resampled(const Vector2 *frames, const float *samples, const int count);
+	void _schedule_encode_task();
+	void _finish_encode_task();
+	void _encode_task();
+	void _dispatch_encoded_packets();
+	bool _apply_dnn_blob();
+	void _update_frame_size();
+
+public:
+	OpusEncoderState();
+	~OpusEncoderState();
+
+	// Creates the encoder with the current properties, replacing any previous one
+	bool initialize();
+	// Frees the encoder until the next initialize()
+	void release();
+	bool is_initialized() const;
+
+	void clear_buffer();
+
+	// Push onto encode buffer (queue)
+	bool can_push_buffer(const int num_samples) const;
+	bool push_buffer(const PackedVector2Array data);
+	bool push_buffer_raw(const PackedFloat32Array data);
+
+	// Pop and encode packets from encode buffer
+	bool has_encoded_packet() const;
+	PackedByteArray get_encoded_packet();
+	Array get_encoded_packets(const int max_packets = -1);
+
+	// Pop packets encoded in the background (async_encoding)
+	PackedByteArray pop_encoded_packet();
+	int get_queued_packet_count() const;
+
+	bool is_in_dtx() const;
+
+	// Replace the DNN weights with a blob (as written by write_lpcnet_weights)
+	bool load_dnn_blob(const PackedByteArray &blob);
+
+	// Not bound; lets GodotOpus emit packet_encoded in place of the state
+	void set_signal_owner(Object *p_owner);
+
+	// Property getters/setters
+
+	void set_sampling_rate(const GodotOpus::SampleRate p_sampling_rate);
+	GodotOpus::SampleRate get_sampling_rate() const;
+
+	void set_channels(const GodotOpus::Channels p_channels);
+	GodotOpus::Channels get_channels() const;
+
+	void set_application_mode(const GodotOpus::ApplicationMode p_application_mode);
+	GodotOpus::ApplicationMode get_application_mode() const;
+
+	void set_max_payload_bytes(const int p_max_payload_bytes);
+	int get_max_payload_bytes() const;
+
+	void set_buffer_length_seconds(const float p_buffer_length_seconds);
+	float get_buffer_length_seconds() const;
+
+	void set_frame_duration(const GodotOpus::FrameSizeDuration p_frame_duration);
+	GodotOpus::FrameSizeDuration get_frame_duration() const;
+
+	void set_bandwidth(const GodotOpus::Bandwidth p_bandwidth);
+	GodotOpus::Bandwidth get_bandwidth() const;
+
+	void set_max_bandwidth(const GodotOpus::Bandwidth p_bandwidth);
+	GodotOpus::Bandwidth get_max_bandwidth() const;
+
+	void set_encoder_complexity(const int p_complexity);
+	int get_encoder_complexity() const;
+
+	void set_async_encoding(const bool p_async_encoding);
+	bool is_async_encoding() const;
+
+	void set_frames_per_packet(const int p_frames_per_packet);
+	int get_frames_per_packet() const;
+
+	void set_mix_rate(const int p_mix_rate);
+	int get_mix_rate() const;
+
+	// Dynamic properties
+
+	void set_bitrate_mode(const GodotOpus::BitrateMode p_mode);
+	GodotOpus::BitrateMode get_bitrate_mode() const;
+
+	void set_bitrate(const int p_bitrate);
+	int get_bitrate() const;
+
+	void set_packet_loss_perc(const int p_packet_loss_perc);
+	int get_packet_loss_perc() const;
+
+	void set_inband_fec(const bool p_inband_fec);
+	bool is_inband_fec() const;
+
+	void set_dtx(const bool p_dtx);
+	bool is_dtx() const;
+
+	void set_dred_duration_ms(const int p_dred_duration_ms);
+	int get_dred_duration_ms() const;
+
+	// Not exposed as properties
+	int get_frame_size() const;
+	int get_lookahead() const;
+};
+
+} //namespace godot
+
+#endif // OPUS_ENCODER_STATE_H
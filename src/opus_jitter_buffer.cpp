@@ -0,0 +1,333 @@
+#include <math.h>
+
+#include <godot_cpp/classes/time.hpp>
+#include <godot_cpp/core/class_db.hpp>
+
+#include "opus_decoder_state.h"
+#include "opus_jitter_buffer.h"
+
+using namespace godot;
+
+OpusJitterBuffer::OpusJitterBuffer() {
+	slot_mask = 0;
+	frame_duration = GodotOpus::FRAMESIZE_20_MS;
+	frame_ms = 20.0f;
+	min_delay_ms = 20;
+	max_delay_ms = 400;
+	jitter_multiplier = 3.0f;
+
+	stats_received = 0;
+	stats_lost = 0;
+	stats_late = 0;
+	stats_duplicate = 0;
+	stats_discarded = 0;
+	stats_underruns = 0;
+
+	set_capacity(64);
+	reset();
+}
+
+void OpusJitterBuffer::_update_jitter(const int64_t timestamp, const uint64_t arrival_ms) {
+	// Relative transit time; the clock offset between peers cancels out in the difference
+	double transit = (double)arrival_ms - (double)timestamp;
+	if (has_transit) {
+		double d = Math::abs(transit - last_transit);
+		jitter_ms += (d - jitter_ms) / 16.0;
+	}
+	last_transit = transit;
+	has_transit = true;
+
+	int delay = (int)ceil(frame_ms + jitter_multiplier * jitter_ms);
+	target_delay_ms = CLAMP(delay, min_delay_ms, max_delay_ms);
+}
+
+int OpusJitterBuffer::_target_frames() const {
+	return MAX(1, (int)ceil(target_delay_ms / frame_ms));
+}
+
+int OpusJitterBuffer::_buffered_frames() const {
+	if (!started) {
+		return 0;
+	}
+	// Span from the playout point to the newest packet, holes included
+	return (int)MAX((int64_t)0, highest_seq - next_seq + 1);
+}
+
+PackedByteArray OpusJitterBuffer::_take(const int64_t seq) {
+	Slot &slot = slots[seq & slot_mask];
+	if (slot.seq != seq) {
+		return PackedByteArray();
+	}
+	PackedByteArray payload = slot.payload;
+	slot.seq = -1;
+	slot.payload = PackedByteArray();
+	return payload;
+}
+
+void OpusJitterBuffer::_flush() {
+	for (uint32_t i = 0; i < slots.size(); i++) {
+		slots[i].seq = -1;
+		slots[i].payload = PackedByteArray();
+	}
+}
+
+bool OpusJitterBuffer::push_packet(const int64_t seq, const int64_t timestamp, const PackedByteArray &payload) {
+	ERR_FAIL_COND_V_MSG(seq < 0, false, "Sequence number must not be negative");
+	ERR_FAIL_COND_V_MSG(payload.is_empty(), false, "Cannot buffer an empty packet");
+
+	uint64_t arrival_ms = Time::get_singleton()->get_ticks_msec();
+
+	if (!started) {
+		started = true;
+		buffering = true;
+		next_seq = seq;
+		highest_seq = seq - 1;
+	}
+
+	if (seq < next_seq) {
+		// Its turn has already been played out (or concealed)
+		stats_late++;
+		return false;
+	}
+
+	if (seq - next_seq >= (int64_t)slots.size()) {
+		// Too far ahead to fit, so the sender has restarted or we fell far behind
+		_flush();
+		next_seq = seq;
+		highest_seq = seq - 1;
+		buffering = true;
+	}
+
+	Slot &slot = slots[seq & slot_mask];
+	if (slot.seq == seq) {
+		stats_duplicate++;
+		return false;
+	}
+	slot.seq = seq;
+	slot.payload = payload;
+	highest_seq = MAX(highest_seq, seq);
+	stats_received++;
+
+	_update_jitter(timestamp, arrival_ms);
+	return true;
+}
+
+PackedByteArray OpusJitterBuffer::pop_packet() {
+	int buffered = _buffered_frames();
+	if (buffered <= 0) {
+		if (started && !buffering) {
+			stats_underruns++;
+		}
+		buffering = true;
+		last_status = STATUS_BUFFERING;
+		return PackedByteArray();
+	}
+
+	int target = _target_frames();
+	if (buffering) {
+		// Sequence numbers the sender skipped while the buffer was dry (DTX
+		// silence, or packets lost during the underrun) aren't worth concealing
+		// after rebuffering; start playout at the first packet that arrived
+		while (next_seq < highest_seq && slots[next_seq & slot_mask].seq != next_seq) {
+			next_seq++;
+		}
+		buffered = _buffered_frames();
+		if (buffered < target) {
+			last_status = STATUS_BUFFERING;
+			return PackedByteArray();
+		}
+		buffering = false;
+	}
+
+	// Jitter has dropped since the buffer filled up, so skip a frame to cut the delay
+	if (buffered > target + 2) {
+		_take(next_seq);
+		next_seq++;
+		stats_discarded++;
+	}
+
+	PackedByteArray payload = _take(next_seq);
+	next_seq++;
+	if (payload.is_empty()) {
+		stats_lost++;
+		last_status = STATUS_LOST;
+	} else {
+		last_status = STATUS_OK;
+	}
+	return payload;
+}
+
+OpusJitterBuffer::PacketStatus OpusJitterBuffer::get_last_status() const {
+	return last_status;
+}
+
+PackedByteArray OpusJitterBuffer::peek_next_packet() const {
+	if (!started) {
+		return PackedByteArray();
+	}
+	const Slot &slot = slots[next_seq & slot_mask];
+	if (slot.seq != next_seq) {
+		return PackedByteArray();
+	}
+	return slot.payload;
+}
+
+PackedVector2Array OpusJitterBuffer::decode_next(Object *p_decoder) {
+	OpusDecoderState *decoder = OpusDecoderState::from_object(p_decoder);
+	ERR_FAIL_NULL_V_MSG(decoder, PackedVector2Array(), "OpusJitterBuffer decodes with a GodotOpus node or an OpusDecoderState");
+
+	PackedByteArray payload = pop_packet();
+	switch (last_status) {
+		case STATUS_OK:
+			return decoder->decode(payload);
+		case STATUS_LOST: {
+			// A burst of losses is rebuilt in one go from the DRED data of the first
+			// packet after it, if that has arrived and the decoder supports DRED
+			int64_t seq = next_seq;
+			while (seq <= highest_seq && slots[seq & slot_mask].seq != seq) {
+				seq++;
+			}
+			if (seq > next_seq && seq <= highest_seq && decoder->is_dred_available()) {
+				const int lost_frames = (int)(seq - next_seq) + 1;
+				stats_lost += lost_frames - 1;
+				next_seq = seq;
+				return decoder->decode_with_dred(slots[seq & slot_mask].payload, lost_frames * decoder->get_frame_size());
+			}
+			// Recovers the frame from the next packet's FEC data if it has arrived, else conceals
+			return decoder->decode_with_fec(peek_next_packet(), decoder->get_frame_size());
+		}
+		default:
+			return PackedVector2Array();
+	}
+}
+
+void OpusJitterBuffer::reset() {
+	_flush();
+	started = false;
+	buffering = true;
+	next_seq = 0;
+	highest_seq = -1;
+	last_status = STATUS_BUFFERING;
+
+	has_transit = false;
+	last_transit = 0.0;
+	jitter_ms = 0.0;
+	target_delay_ms = CLAMP((int)ceil(frame_ms), min_delay_ms, max_delay_ms);
+}
+
+int OpusJitterBuffer::get_buffered_frames() const {
+	return _buffered_frames();
+}
+
+int OpusJitterBuffer::get_target_delay_ms() const {
+	return target_delay_ms;
+}
+
+float OpusJitterBuffer::get_jitter_ms() const {
+	return (float)jitter_ms;
+}
+
+Dictionary OpusJitterBuffer::get_stats() const {
+	Dictionary stats;
+	stats["received"] = (int64_t)stats_received;
+	stats["lost"] = (int64_t)stats_lost;
+	stats["late"] = (int64_t)stats_late;
+	stats["duplicate"] = (int64_t)stats_duplicate;
+	stats["discarded"] = (int64_t)stats_discarded;
+	stats["underruns"] = (int64_t)stats_underruns;
+	stats["jitter_ms"] = jitter_ms;
+	stats["target_delay_ms"] = target_delay_ms;
+	stats["buffered_frames"] = _buffered_frames();
+	return stats;
+}
+
+// Getters and Setters ////////////////////////////////////////////////////////
+
+void OpusJitterBuffer::set_capacity(const int p_capacity) {
+	ERR_FAIL_COND_MSG(p_capacity < 2 || p_capacity > 4096, "Capacity must be between 2 and 4096 packets");
+	int power = nearest_shift(p_capacity - 1);
+	slots.resize(1 << power);
+	slot_mask = (1 << power) - 1;
+	reset();
+}
+
+int OpusJitterBuffer::get_capacity() const {
+	return slots.size();
+}
+
+void OpusJitterBuffer::set_frame_duration(const GodotOpus::FrameSizeDuration p_frame_duration) {
+	int samples = GodotOpus::calculate_frame_size(48000, p_frame_duration);
+	ERR_FAIL_COND_MSG(samples <= 0, "Invalid frame duration");
+	frame_duration = p_frame_duration;
+	frame_ms = samples / 48.0f;
+	reset();
+}
+
+GodotOpus::FrameSizeDuration OpusJitterBuffer::get_frame_duration() const {
+	return frame_duration;
+}
+
+void OpusJitterBuffer::set_min_delay_ms(const int p_min_delay_ms) {
+	ERR_FAIL_COND_MSG(p_min_delay_ms < 0, "min_delay_ms must not be negative");
+	min_delay_ms = p_min_delay_ms;
+	max_delay_ms = MAX(max_delay_ms, min_delay_ms);
+}
+
+int OpusJitterBuffer::get_min_delay_ms() const {
+	return min_delay_ms;
+}
+
+void OpusJitterBuffer::set_max_delay_ms(const int p_max_delay_ms) {
+	ERR_FAIL_COND_MSG(p_max_delay_ms < 0, "max_delay_ms must not be negative");
+	max_delay_ms = p_max_delay_ms;
+	min_delay_ms = MIN(min_delay_ms, max_delay_ms);
+}
+
+int OpusJitterBuffer::get_max_delay_ms() const {
+	return max_delay_ms;
+}
+
+void OpusJitterBuffer::set_jitter_multiplier(const float p_jitter_multiplier) {
+	ERR_FAIL_COND_MSG(p_jitter_multiplier < 0.0f, "jitter_multiplier must not be negative");
+	jitter_multiplier = p_jitter_multiplier;
+}
+
+float OpusJitterBuffer::get_jitter_multiplier() const {
+	return jitter_multiplier;
+}
+
+// Bind methods
+
+void OpusJitterBuffer::_bind_methods() {
+	ClassDB::bind_method(D_METHOD("push_packet", "seq", "timestamp", "payload"), &OpusJitterBuffer::push_packet);
+	ClassDB::bind_method(D_METHOD("pop_packet"), &OpusJitterBuffer::pop_packet);
+	ClassDB::bind_method(D_METHOD("get_last_status"), &OpusJitterBuffer::get_last_status);
+	ClassDB::bind_method(D_METHOD("peek_next_packet"), &OpusJitterBuffer::peek_next_packet);
+	ClassDB::bind_method(D_METHOD("decode_next", "decoder"), &OpusJitterBuffer::decode_next);
+	ClassDB::bind_method(D_METHOD("reset"), &OpusJitterBuffer::reset);
+	ClassDB::bind_method(D_METHOD("get_buffered_frames"), &OpusJitterBuffer::get_buffered_frames);
+	ClassDB::bind_method(D_METHOD("get_target_delay_ms"), &OpusJitterBuffer::get_target_delay_ms);
+	ClassDB::bind_method(D_METHOD("get_jitter_ms"), &OpusJitterBuffer::get_jitter_ms);
+	ClassDB::bind_method(D_METHOD("get_stats"), &OpusJitterBuffer::get_stats);
+
+	ClassDB::bind_method(D_METHOD("get_capacity"), &OpusJitterBuffer::get_capacity);
+	ClassDB::bind_method(D_METHOD("set_capacity", "p_capacity"), &OpusJitterBuffer::set_capacity);
+	ClassDB::bind_method(D_METHOD("get_frame_duration"), &OpusJitterBuffer::get_frame_duration);
+	ClassDB::bind_method(D_METHOD("set_frame_duration", "p_frame_duration"), &OpusJitterBuffer::set_frame_duration);
+	ClassDB::bind_method(D_METHOD("get_min_delay_ms"), &OpusJitterBuffer::get_min_delay_ms);
+	ClassDB::bind_method(D_METHOD("set_min_delay_ms", "p_min_delay_ms"), &OpusJitterBuffer::set_min_delay_ms);
+	ClassDB::bind_method(D_METHOD("get_max_delay_ms"), &OpusJitterBuffer::get_max_delay_ms);
+	ClassDB::bind_method(D_METHOD("set_max_delay_ms", "p_max_delay_ms"), &OpusJitterBuffer::set_max_delay_ms);
+	ClassDB::bind_method(D_METHOD("get_jitter_multiplier"), &OpusJitterBuffer::get_jitter_multiplier);
+	ClassDB::bind_method(D_METHOD("set_jitter_multiplier", "p_jitter_multiplier"), &OpusJitterBuffer::set_jitter_multiplier);
+
+	ClassDB::add_property("OpusJitterBuffer", PropertyInfo(Variant::INT, "capacity", PROPERTY_HINT_RANGE, "2,4096,1"), "set_capacity", "get_capacity");
+	ClassDB::add_property("OpusJitterBuffer", PropertyInfo(Variant::INT, "frame_duration", PROPERTY_HINT_ENUM, "2.5 ms:5001,5 ms:5002,10 ms:5003,20 ms:5004,40 ms:5005,60 ms:5006,80 ms:5007,100 ms:5008,120 ms:5009"), "set_frame_duration", "get_frame_duration");
+	ClassDB::add_property("OpusJitterBuffer", PropertyInfo(Variant::INT, "min_delay_ms", PROPERTY_HINT_RANGE, "0,1000,1,suffix:ms"), "set_min_delay_ms", "get_min_delay_ms");
+	ClassDB::add_property("OpusJitterBuffer", PropertyInfo(Variant::INT, "max_delay_ms", PROPERTY_HINT_RANGE, "0,2000,1,suffix:ms"), "set_max_delay_ms", "get_max_delay_ms");
+	ClassDB::add_property("OpusJitterBuffer", PropertyInfo(Variant::FLOAT, "jitter_multiplier", PROPERTY_HINT_RANGE, "0,10,0.1"), "set_jitter_multiplier", "get_jitter_multiplier");
+
+	BIND_ENUM_CONSTANT(STATUS_OK);
+	BIND_ENUM_CONSTANT(STATUS_LOST);
+	BIND_ENUM_CONSTANT(STATUS_BUFFERING);
+}
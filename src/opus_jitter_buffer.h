@@ -0,0 +1,107 @@
+#ifndef OPUS_JITTER_BUFFER_H
+#define OPUS_JITTER_BUFFER_H
+
+#include <godot_cpp/classes/ref_counted.hpp>
+#include <godot_cpp/templates/local_vector.hpp>
+
+#include "godot_opus.h"
+
+namespace godot {
+
+// Reorders received packets by sequence number and plays them out at a delay
+// that adapts to the measured network jitter. Call pop_packet (or decode_next)
+// for each frame the receiving side needs; holes in the sequence are reported
+// as lost so they can be concealed, and packets arriving after their turn are
+// dropped. When the buffer runs dry it rebuffers up to the target delay.
+class OpusJitterBuffer : public RefCounted {
+	GDCLASS(OpusJitterBuffer, RefCounted)
+
+public:
+	enum PacketStatus {
+		STATUS_OK,
+		STATUS_LOST,
+		STATUS_BUFFERING
+	};
+
+private:
+	struct Slot {
+		int64_t seq = -1;
+		PackedByteArray payload;
+	};
+
+	LocalVector<Slot> slots;
+	uint32_t slot_mask;
+
+	GodotOpus::FrameSizeDuration frame_duration;
+	float frame_ms;
+	int min_delay_ms;
+	int max_delay_ms;
+	float jitter_multiplier;
+
+	bool started;
+	bool buffering;
+	int64_t next_seq;
+	int64_t highest_seq;
+	PacketStatus last_status;
+
+	// RFC 3550 interarrival jitter estimate, in ms
+	bool has_transit;
+	double last_transit;
+	double jitter_ms;
+	int target_delay_ms;
+
+	uint64_t stats_received;
+	uint64_t stats_lost;
+	uint64_t stats_late;
+	uint64_t stats_duplicate;
+	uint64_t stats_discarded;
+	uint64_t stats_underruns;
+
+	void _update_jitter(const int64_t timestamp, const uint64_t arrival_ms);
+	int _target_frames() const;
+	int _buffered_frames() const;
+	PackedByteArray _take(const int64_t seq);
+	void _flush();
+
+protected:
+	static void _bind_methods();
+
+public:
+	OpusJitterBuffer();
+
+	bool push_packet(const int64_t seq, const int64_t timestamp, const PackedByteArray &payload);
+	PackedByteArray pop_packet();
+	PacketStatus get_last_status() const;
+	PackedByteArray peek_next_packet() const;
+
+	// Pop and decode with the given GodotOpus (decoder configured) or
+	// OpusDecoderState, concealing lost packets
+	PackedVector2Array decode_next(Object *p_decoder);
+
+	void reset();
+	int get_buffered_frames() const;
+	int get_target_delay_ms() const;
+	float get_jitter_ms() const;
+	Dictionary get_stats() const;
+
+	void set_capacity(const int p_capacity);
+	int get_capacity() const;
+
+	void set_frame_duration(const GodotOpus::FrameSizeDuration p_frame_duration);
+	GodotOpus::FrameSizeDuration get_frame_duration() const;
+
+	void set_min_delay_ms(const int p_min_delay_ms);
+	int get_min_delay_ms() const;
+
+	void set_max_delay_ms(const int p_max_delay_ms);
+	int get_max_delay_ms() const;
+
+	void set_jitter_multiplier(const float p_jitter_multiplier);
+	float get_jitter_multiplier() const;
+};
+
+} //namespace godot
+
+VARIANT_ENUM_CAST(OpusJitterBuffer::PacketStatus);
+
+#endif // OPUS_JITTER_BUFFER_H
@@ -0,0 +1,312 @@
+#include <string.h>
+
+#include <godot_cpp/core/class_db.hpp>
+
+#include "opus_multistream.h"
+
+using namespace godot;
+
+OpusMultistream::OpusMultistream() {
+	encoder = NULL;
+	decoder = NULL;
+
+	encoder_enabled = true;
+	decoder_enabled = true;
+
+	sampling_rate = GodotOpus::SAMPLE_RATE_48000;
+	channels = 6;
+	application_mode = GodotOpus::APPLICATION_MODE_AUDIO;
+	frame_duration = GodotOpus::FRAMESIZE_20_MS;
+	bitrate_bps = OPUS_AUTO;
+	encoder_complexity = 10;
+	max_payload_bytes = 4000;
+	frame_size = 960;
+
+	streams = 0;
+	coupled_streams = 0;
+	memset(mapping, 0, sizeof(mapping));
+}
+
+OpusMultistream::~OpusMultistream() {
+	_destroy();
+}
+
+void OpusMultistream::_destroy() {
+	if (encoder != NULL) {
+		opus_multistream_encoder_destroy(encoder);
+		encoder = NULL;
+	}
+	if (decoder != NULL) {
+		opus_multistream_decoder_destroy(decoder);
+		decoder = NULL;
+	}
+}
+
+int OpusMultistream::_mapping_family() const {
+	// Family 0 is plain mono/stereo, family 1 the Vorbis surround layouts
+	return channels > 2 ? 1 : 0;
+}
+
+bool OpusMultistream::initialize() {
+	_destroy();
+
+	frame_size = GodotOpus::calculate_frame_size((int)sampling_rate, frame_duration);
+
+	// The surround helper picks the stream layout; since it only depends on the
+	// channel count, both ends derive the same one for the decoder.
+	int err;
+	OpusMSEncoder *layout_encoder = opus_multistream_surround_encoder_create((int)sampling_rate, channels, _mapping_family(), &streams, &coupled_streams, mapping, (int)application_mode, &err);
+	ERR_FAIL_COND_V_MSG(err != OPUS_OK, false, opus_strerror(err));
+
+	if (encoder_enabled) {
+		encoder = layout_encoder;
+		if (bitrate_bps != OPUS_AUTO) {
+			opus_multistream_encoder_ctl(encoder, OPUS_SET_BITRATE(bitrate_bps));
+		}
+		opus_multistream_encoder_ctl(encoder, OPUS_SET_COMPLEXITY(encoder_complexity));
+
+		encode_pcm.resize(frame_size * channels);
+		encode_data.resize(max_payload_bytes);
+	} else {
+		opus_multistream_encoder_destroy(layout_encoder);
+	}
+
+	if (decoder_enabled) {
+		decoder = opus_multistream_decoder_create((int)sampling_rate, channels, streams, coupled_streams, mapping, &err);
+		ERR_FAIL_COND_V_MSG(err != OPUS_OK, false, opus_strerror(err));
+
+		// Largest packet is 120 ms of audio
+		decode_pcm.resize((int)sampling_rate * 120 / 1000 * channels);
+	}
+
+	return true;
+}
+
+PackedByteArray OpusMultistream::_encode(const float *pcm) {
+	opus_int32 encoded_length = opus_multistream_encode_float(encoder, pcm, frame_size, encode_data.ptrw(), encode_data.size());
+	ERR_FAIL_COND_V_MSG(encoded_length < 0, PackedByteArray(), opus_strerror(encoded_length));
+
+	PackedByteArray ret;
+	ret.resize(encoded_length);
+	memcpy(ret.ptrw(), encode_data.ptr(), encoded_length);
+	return ret;
+}
+
+PackedByteArray OpusMultistream::encode(const PackedFloat32Array &pcm) {
+	ERR_FAIL_NULL_V_MSG(encoder, PackedByteArray(), "OpusMultistream not initialized with encoder configured");
+	ERR_FAIL_COND_V_MSG(pcm.size() != frame_size * channels, PackedByteArray(), "Encode expects exactly one frame of interleaved samples");
+
+	return _encode(pcm.ptr());
+}
+
+PackedByteArray OpusMultistream::encode_planar(const Array &planes) {
+	ERR_FAIL_NULL_V_MSG(encoder, PackedByteArray(), "OpusMultistream not initialized with encoder configured");
+	ERR_FAIL_COND_V_MSG(planes.size() != channels, PackedByteArray(), "Encode expects one array per channel");
+
+	float *dst = encode_pcm.ptrw();
+	for (int c = 0; c < channels; c++) {
+		PackedFloat32Array plane = planes[c];
+		ERR_FAIL_COND_V_MSG(plane.size() != frame_size, PackedByteArray(), "Each channel must hold exactly one frame of samples");
+		const float *src = plane.ptr();
+		for (int i = 0; i < frame_size; i++) {
+			dst[i * channels + c] = src[i];
+		}
+	}
+	return _encode(dst);
+}
+
+int OpusMultistream::_decode(const PackedByteArray &packet) {
+	// An empty packet is concealed as a lost frame
+	const int max_samples = decode_pcm.size() / channels;
+	int decoded;
+	if (packet.is_empty()) {
+		decoded = opus_multistream_decode_float(decoder, NULL, 0, decode_pcm.ptrw(), frame_size, 0);
+	} else {
+		decoded = opus_multistream_decode_float(decoder, packet.ptr(), packet.size(), decode_pcm.ptrw(), max_samples, 0);
+	}
+	ERR_FAIL_COND_V_MSG(decoded < 0, -1, opus_strerror(decoded));
+	return decoded;
+}
+
+PackedFloat32Array OpusMultistream::decode(const PackedByteArray &packet) {
+	ERR_FAIL_NULL_V_MSG(decoder, PackedFloat32Array(), "OpusMultistream not initialized with decoder configured");
+
+	int decoded = _decode(packet);
+	if (decoded < 0) {
+		return PackedFloat32Array();
+	}
+
+	PackedFloat32Array ret;
+	ret.resize(decoded * channels);
+	memcpy(ret.ptrw(), decode_pcm.ptr(), sizeof(float) * decoded * channels);
+	return ret;
+}
+
+Array OpusMultistream::decode_planar(const PackedByteArray &packet) {
+	ERR_FAIL_NULL_V_MSG(decoder, Array(), "OpusMultistream not initialized with decoder configured");
+
+	int decoded = _decode(packet);
+	if (decoded < 0) {
+		return Array();
+	}
+
+	Array ret;
+	const float *src = decode_pcm.ptr();
+	for (int c = 0; c < channels; c++) {
+		PackedFloat32Array plane;
+		plane.resize(decoded);
+		float *dst = plane.ptrw();
+		for (int i = 0; i < decoded; i++) {
+			dst[i] = src[i * channels + c];
+		}
+		ret.push_back(plane);
+	}
+	return ret;
+}
+
+int OpusMultistream::get_frame_size() const {
+	return frame_size;
+}
+
+int OpusMultistream::get_stream_count() const {
+	return streams;
+}
+
+int OpusMultistream::get_coupled_stream_count() const {
+	return coupled_streams;
+}
+
+PackedByteArray OpusMultistream::get_channel_mapping() const {
+	PackedByteArray ret;
+	if (streams == 0) {
+		return ret;
+	}
+	ret.resize(channels);
+	memcpy(ret.ptrw(), mapping, channels);
+	return ret;
+}
+
+// Getters and Setters ////////////////////////////////////////////////////////
+// Applied on initialize().
+
+void OpusMultistream::set_encoder_enabled(const bool p_encoder_enabled) {
+	encoder_enabled = p_encoder_enabled;
+}
+
+bool OpusMultistream::is_encoder_enabled() const {
+	return encoder_enabled;
+}
+
+void OpusMultistream::set_decoder_enabled(const bool p_decoder_enabled) {
+	decoder_enabled = p_decoder_enabled;
+}
+
+bool OpusMultistream::is_decoder_enabled() const {
+	return decoder_enabled;
+}
+
+void OpusMultistream::set_sampling_rate(const GodotOpus::SampleRate p_sampling_rate) {
+	sampling_rate = p_sampling_rate;
+}
+
+GodotOpus::SampleRate OpusMultistream::get_sampling_rate() const {
+	return sampling_rate;
+}
+
+void OpusMultistream::set_channels(const int p_channels) {
+	ERR_FAIL_COND_MSG(p_channels < 1 || p_channels > 8, "OpusMultistream supports 1 to 8 channels");
+	channels = p_channels;
+}
+
+int OpusMultistream::get_channels() const {
+	return channels;
+}
+
+void OpusMultistream::set_application_mode(const GodotOpus::ApplicationMode p_application_mode) {
+	application_mode = p_application_mode;
+}
+
+GodotOpus::ApplicationMode OpusMultistream::get_application_mode() const {
+	return application_mode;
+}
+
+void OpusMultistream::set_frame_duration(const GodotOpus::FrameSizeDuration p_frame_duration) {
+	frame_duration = p_frame_duration;
+}
+
+GodotOpus::FrameSizeDuration OpusMultistream::get_frame_duration() const {
+	return frame_duration;
+}
+
+void OpusMultistream::set_bitrate(const int p_bitrate) {
+	bitrate_bps = p_bitrate;
+	if (encoder != NULL) {
+		opus_multistream_encoder_ctl(encoder, OPUS_SET_BITRATE(bitrate_bps));
+	}
+}
+
+int OpusMultistream::get_bitrate() const {
+	return bitrate_bps;
+}
+
+void OpusMultistream::set_encoder_complexity(const int p_complexity) {
+	encoder_complexity = p_complexity;
+	if (encoder != NULL) {
+		opus_multistream_encoder_ctl(encoder, OPUS_SET_COMPLEXITY(encoder_complexity));
+	}
+}
+
+int OpusMultistream::get_encoder_complexity() const {
+	return encoder_complexity;
+}
+
+void OpusMultistream::set_max_payload_bytes(const int p_max_payload_bytes) {
+	max_payload_bytes = p_max_payload_bytes;
+}
+
+int OpusMultistream::get_max_payload_bytes() const {
+	return max_payload_bytes;
+}
+
+// Bind methods
+
+void OpusMultistream::_bind_methods() {
+	ClassDB::bind_method(D_METHOD("initialize"), &OpusMultistream::initialize);
+	ClassDB::bind_method(D_METHOD("encode", "pcm"), &OpusMultistream::encode);
+	ClassDB::bind_method(D_METHOD("encode_planar", "planes"), &OpusMultistream::encode_planar);
+	ClassDB::bind_method(D_METHOD("decode", "packet"), &OpusMultistream::decode);
+	ClassDB::bind_method(D_METHOD("decode_planar", "packet"), &OpusMultistream::decode_planar);
+	ClassDB::bind_method(D_METHOD("get_frame_size"), &OpusMultistream::get_frame_size);
+	ClassDB::bind_method(D_METHOD("get_stream_count"), &OpusMultistream::get_stream_count);
+	ClassDB::bind_method(D_METHOD("get_coupled_stream_count"), &OpusMultistream::get_coupled_stream_count);
+	ClassDB::bind_method(D_METHOD("get_channel_mapping"), &OpusMultistream::get_channel_mapping);
+
+	ClassDB::bind_method(D_METHOD("is_encoder_enabled"), &OpusMultistream::is_encoder_enabled);
+	ClassDB::bind_method(D_METHOD("set_encoder_enabled", "p_encoder_enabled"), &OpusMultistream::set_encoder_enabled);
+	ClassDB::bind_method(D_METHOD("is_decoder_enabled"), &OpusMultistream::is_decoder_enabled);
+	ClassDB::bind_method(D_METHOD("set_decoder_enabled", "p_decoder_enabled"), &OpusMultistream::set_decoder_enabled);
+	ClassDB::bind_method(D_METHOD("get_sampling_rate"), &OpusMultistream::get_sampling_rate);
+	ClassDB::bind_method(D_METHOD("set_sampling_rate", "p_sampling_rate"), &OpusMultistream::set_sampling_rate);
+	ClassDB::bind_method(D_METHOD("get_channels"), &OpusMultistream::get_channels);
+	ClassDB::bind_method(D_METHOD("set_channels", "p_channels"), &OpusMultistream::set_channels);
+	ClassDB::bind_method(D_METHOD("get_application_mode"), &OpusMultistream::get_application_mode);
+	ClassDB::bind_method(D_METHOD("set_application_mode", "p_application_mode"), &OpusMultistream::set_application_mode);
+	ClassDB::bind_method(D_METHOD("get_frame_duration"), &OpusMultistream::get_frame_duration);
+	ClassDB::bind_method(D_METHOD("set_frame_duration", "p_frame_duration"), &OpusMultistream::set_frame_duration);
+	ClassDB::bind_method(D_METHOD("get_bitrate"), &OpusMultistream::get_bitrate);
+	ClassDB::bind_method(D_METHOD("set_bitrate", "p_bitrate"), &OpusMultistream::set_bitrate);
+	ClassDB::bind_method(D_METHOD("get_encoder_complexity"), &OpusMultistream::get_encoder_complexity);
+	ClassDB::bind_method(D_METHOD("set_encoder_complexity", "p_complexity"), &OpusMultistream::set_encoder_complexity);
+	ClassDB::bind_method(D_METHOD("get_max_payload_bytes"), &OpusMultistream::get_max_payload_bytes);
+	ClassDB::bind_method(D_METHOD("set_max_payload_bytes", "p_max_payload_bytes"), &OpusMultistream::set_max_payload_bytes);
+
+	ClassDB::add_property("OpusMultistream", PropertyInfo(Variant::BOOL, "encoder_enabled"), "set_encoder_enabled", "is_encoder_enabled");
+	ClassDB::add_property("OpusMultistream", PropertyInfo(Variant::BOOL, "decoder_enabled"), "set_decoder_enabled", "is_decoder_enabled");
+	ClassDB::add_property("OpusMultistream", PropertyInfo(Variant::INT, "sampling_rate", PROPERTY_HINT_ENUM, "8 kHz:8000,12 kHz:12000,16 kHz:16000,24 kHz:24000,48 kHz:48000"), "set_sampling_rate", "get_sampling_rate");
+	ClassDB::add_property("OpusMultistream", PropertyInfo(Variant::INT, "channels", PROPERTY_HINT_ENUM, "Mono:1,Stereo:2,Linear Surround:3,Quadraphonic:4,5.0 Surround:5,5.1 Surround:6,6.1 Surround:7,7.1 Surround:8"), "set_channels", "get_channels");
+	ClassDB::add_property("OpusMultistream", PropertyInfo(Variant::INT, "application_mode", PROPERTY_HINT_ENUM, "VoIP:2048,Audio:2049,Restricted-LowDelay:2051"), "set_application_mode", "get_application_mode");
+	ClassDB::add_property("OpusMultistream", PropertyInfo(Variant::INT, "frame_duration", PROPERTY_HINT_ENUM, "2.5 ms:5001,5 ms:5002,10 ms:5003,20 ms:5004,40 ms:5005,60 ms:5006,80 ms:5007,100 ms:5008,120 ms:5009"), "set_frame_duration", "get_frame_duration");
+	ClassDB::add_property("OpusMultistream", PropertyInfo(Variant::INT, "bitrate", PROPERTY_HINT_RANGE, "-1000,2048000,1000,suffix:bps"), "set_bitrate", "get_bitrate");
+	ClassDB::add_property("OpusMultistream", PropertyInfo(Variant::INT, "encoder_complexity", PROPERTY_HINT_RANGE, "0,10,1"), "set_encoder_complexity", "get_encoder_complexity");
+	ClassDB::add_property("OpusMultistream", PropertyInfo(Variant::INT, "max_payload_bytes", PROPERTY_HINT_RANGE, "16,8000,16,suffix:B"), "set_max_payload_bytes", "get_max_payload_bytes");
+}
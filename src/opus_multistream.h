@@ -0,0 +1,97 @@
+#ifndef GODOT_OPUS_MULTISTREAM_H
+#define GODOT_OPUS_MULTISTREAM_H
+
+#include <opus_multistream.h>
+#include <godot_cpp/classes/ref_counted.hpp>
+
+#include "godot_opus.h"
+
+namespace godot {
+
+// Encodes and decodes surround audio (up to 8 channels, e.g. 5.1 or 7.1) as a
+// single Opus multistream, with channel pairs coupled the way the surround
+// mapping defines. Samples use the Vorbis channel order, either interleaved or
+// as one array per channel (planar).
+class OpusMultistream : public RefCounted {
+	GDCLASS(OpusMultistream, RefCounted)
+
+	OpusMSEncoder *encoder;
+	OpusMSDecoder *decoder;
+
+	bool encoder_enabled;
+	bool decoder_enabled;
+
+	GodotOpus::SampleRate sampling_rate;
+	int channels;
+	GodotOpus::ApplicationMode application_mode;
+	GodotOpus::FrameSizeDuration frame_duration;
+	int bitrate_bps;
+	int encoder_complexity;
+	int max_payload_bytes;
+	int frame_size;
+
+	int streams;
+	int coupled_streams;
+	unsigned char mapping[255];
+
+	PackedFloat32Array encode_pcm;
+	// Sized by initialize(), so max_payload_bytes only applies from then on
+	PackedByteArray encode_data;
+	PackedFloat32Array decode_pcm;
+
+	void _destroy();
+	int _mapping_family() const;
+	PackedByteArray _encode(const float *pcm);
+	int _decode(const PackedByteArray &packet);
+
+protected:
+	static void _bind_methods();
+
+public:
+	OpusMultistream();
+	~OpusMultistream();
+
+	bool initialize();
+
+	PackedByteArray encode(const PackedFloat32Array &pcm);
+	PackedByteArray encode_planar(const Array &planes);
+
+	PackedFloat32Array decode(const PackedByteArray &packet);
+	Array decode_planar(const PackedByteArray &packet);
+
+	int get_frame_size() const;
+	int get_stream_count() const;
+	int get_coupled_stream_count() const;
+	PackedByteArray get_channel_mapping() const;
+
+	void set_encoder_enabled(const bool p_encoder_enabled);
+	bool is_encoder_enabled() const;
+
+	void set_decoder_enabled(const bool p_decoder_enabled);
+	bool is_decoder_enabled() const;
+
+	void set_sampling_rate(const GodotOpus::SampleRate p_sampling_rate);
+	GodotOpus::SampleRate get_sampling_rate() const;
+
+	void set_channels(const int p_channels);
+	int get_channels() const;
+
+	void set_application_mode(const GodotOpus::ApplicationMode p_application_mode);
+	GodotOpus::ApplicationMode get_application_mode() const;
+
+	void set_frame_duration(const GodotOpus::FrameSizeDuration p_frame_duration);
+	GodotOpus::FrameSizeDuration get_frame_duration() const;
+
+	void set_bitrate(const int p_bitrate);
+	int get_bitrate() const;
+
+	void set_encoder_complexity(const int p_complexity);
+	int get_encoder_complexity() const;
+
+	void set_max_payload_bytes(const int p_max_payload_bytes);
+	int get_max_payload_bytes() const;
+};
+
+} //namespace godot
+
+#endif // GODOT_OPUS_MULTISTREAM_H
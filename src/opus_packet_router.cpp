@@ -0,0 +1,212 @@
+#include <opus.h>
+#include <godot_cpp/core/class_db.hpp>
+
+#include "opus_packet_router.h"
+
+using namespace godot;
+
+OpusPacketRouter::OpusPacketRouter() {
+	max_outbox_packets = 64;
+	routed_packets = 0;
+	rejected_packets = 0;
+}
+
+bool OpusPacketRouter::validate_packet(const PackedByteArray &packet) {
+	if (packet.is_empty()) {
+		return false;
+	}
+	// opus_packet_parse checks the frame count, sizes and padding against the length,
+	// and the total duration against the 120 ms limit, without touching the payload
+	unsigned char toc;
+	const unsigned char *frames[48];
+	opus_int16 sizes[48];
+	int payload_offset;
+	int nb_frames = opus_packet_parse(packet.ptr(), packet.size(), &toc, frames, sizes, &payload_offset);
+	if (nb_frames <= 0) {
+		return false;
+	}
+	return opus_packet_get_nb_samples(packet.ptr(), packet.size(), 48000) <= 48000 * 120 / 1000;
+}
+
+Dictionary OpusPacketRouter::get_packet_info(const PackedByteArray &packet, const int sampling_rate) {
+	Dictionary info;
+	info["valid"] = validate_packet(packet);
+	if (!(bool)info["valid"]) {
+		return info;
+	}
+
+	const uint8_t *data = packet.ptr();
+	const int frames = opus_packet_get_nb_frames(data, packet.size());
+	const int samples_per_frame = opus_packet_get_samples_per_frame(data, sampling_rate);
+	info["bandwidth"] = opus_packet_get_bandwidth(data);
+	info["channels"] = opus_packet_get_nb_channels(data);
+	info["frames"] = frames;
+	info["samples_per_frame"] = samples_per_frame;
+	info["samples"] = frames * samples_per_frame;
+	info["size"] = packet.size();
+	return info;
+}
+
+void OpusPacketRouter::subscribe(const int32_t stream_id, const int32_t subscriber_id) {
+	LocalVector<int32_t> &subscribers = subscriptions[stream_id];
+	if (subscribers.find(subscriber_id) < 0) {
+		subscribers.push_back(subscriber_id);
+	}
+	if (!outboxes.has(subscriber_id)) {
+		outboxes.insert(subscriber_id, Outbox());
+	}
+}
+
+void OpusPacketRouter::unsubscribe(const int32_t stream_id, const int32_t subscriber_id) {
+	HashMap<int32_t, LocalVector<int32_t>>::Iterator E = subscriptions.find(stream_id);
+	if (!E) {
+		return;
+	}
+	E->value.erase(subscriber_id);
+	if (E->value.is_empty()) {
+		subscriptions.erase(stream_id);
+	}
+}
+
+void OpusPacketRouter::remove_subscriber(const int32_t subscriber_id) {
+	LocalVector<int32_t> empty_streams;
+	for (KeyValue<int32_t, LocalVector<int32_t>> &E : subscriptions) {
+		E.value.erase(subscriber_id);
+		if (E.value.is_empty()) {
+			empty_streams.push_back(E.key);
+		}
+	}
+	for (uint32_t i = 0; i < empty_streams.size(); i++) {
+		subscriptions.erase(empty_streams[i]);
+	}
+	outboxes.erase(subscriber_id);
+}
+
+void OpusPacketRouter::remove_stream(const int32_t stream_id) {
+	subscriptions.erase(stream_id);
+}
+
+PackedInt32Array OpusPacketRouter::get_subscribers(const int32_t stream_id) const {
+	PackedInt32Array ret;
+	HashMap<int32_t, LocalVector<int32_t>>::ConstIterator E = subscriptions.find(stream_id);
+	if (!E) {
+		return ret;
+	}
+	ret.resize(E->value.size());
+	for (uint32_t i = 0; i < E->value.size(); i++) {
+		ret.set(i, E->value[i]);
+	}
+	return ret;
+}
+
+void OpusPacketRouter::clear() {
+	subscriptions.clear();
+	outboxes.clear();
+	routed_packets = 0;
+	rejected_packets = 0;
+}
+
+int OpusPacketRouter::route_packet(const int32_t stream_id, const PackedByteArray &packet) {
+	if (!validate_packet(packet)) {
+		rejected_packets++;
+		return -1;
+	}
+
+	HashMap<int32_t, LocalVector<int32_t>>::Iterator E = subscriptions.find(stream_id);
+	if (!E) {
+		return 0;
+	}
+
+	RoutedPacket routed;
+	routed.stream_id = stream_id;
+	routed.packet = packet;
+
+	const LocalVector<int32_t> &subscribers = E->value;
+	for (uint32_t i = 0; i < subscribers.size(); i++) {
+		Outbox &outbox = outboxes[subscribers[i]];
+		// A subscriber that stops draining its outbox loses its oldest packets
+		if (outbox.packets.size() >= max_outbox_packets) {
+			outbox.packets.pop_front();
+			outbox.dropped++;
+		}
+		// Shares the packet's buffer, it isn't copied
+		outbox.packets.push_back(routed);
+	}
+	routed_packets++;
+	return subscribers.size();
+}
+
+int OpusPacketRouter::get_outbox_size(const int32_t subscriber_id) const {
+	HashMap<int32_t, Outbox>::ConstIterator E = outboxes.find(subscriber_id);
+	if (!E) {
+		return 0;
+	}
+	return E->value.packets.size();
+}
+
+Array OpusPacketRouter::take_packets(const int32_t subscriber_id) {
+	Array ret;
+	HashMap<int32_t, Outbox>::Iterator E = outboxes.find(subscriber_id);
+	if (!E) {
+		return ret;
+	}
+
+	List<RoutedPacket> &packets = E->value.packets;
+	ret.resize(packets.size() * 2);
+	int i = 0;
+	for (const RoutedPacket &routed : packets) {
+		ret[i++] = routed.stream_id;
+		ret[i++] = routed.packet;
+	}
+	packets.clear();
+	return ret;
+}
+
+Dictionary OpusPacketRouter::get_stats() const {
+	uint64_t dropped = 0;
+	for (const KeyValue<int32_t, Outbox> &E : outboxes) {
+		dropped += E.value.dropped;
+	}
+
+	Dictionary stats;
+	stats["routed"] = (int64_t)routed_packets;
+	stats["rejected"] = (int64_t)rejected_packets;
+	stats["dropped"] = (int64_t)dropped;
+	stats["streams"] = subscriptions.size();
+	stats["subscribers"] = outboxes.size();
+	return stats;
+}
+
+// Getters and Setters ////////////////////////////////////////////////////////
+
+void OpusPacketRouter::set_max_outbox_packets(const int p_max_outbox_packets) {
+	ERR_FAIL_COND_MSG(p_max_outbox_packets < 1, "max_outbox_packets must be at least 1");
+	max_outbox_packets = p_max_outbox_packets;
+}
+
+int OpusPacketRouter::get_max_outbox_packets() const {
+	return max_outbox_packets;
+}
+
+// Bind methods
+
+void OpusPacketRouter::_bind_methods() {
+	ClassDB::bind_static_method("OpusPacketRouter", D_METHOD("validate_packet", "packet"), &OpusPacketRouter::validate_packet);
+	ClassDB::bind_static_method("OpusPacketRouter", D_METHOD("get_packet_info", "packet", "sampling_rate"), &OpusPacketRouter::get_packet_info, DEFVAL(48000));
+
+	ClassDB::bind_method(D_METHOD("subscribe", "stream_id", "subscriber_id"), &OpusPacketRouter::subscribe);
+	ClassDB::bind_method(D_METHOD("unsubscribe", "stream_id", "subscriber_id"), &OpusPacketRouter::unsubscribe);
+	ClassDB::bind_method(D_METHOD("remove_subscriber", "subscriber_id"), &OpusPacketRouter::remove_subscriber);
+	ClassDB::bind_method(D_METHOD("remove_stream", "stream_id"), &OpusPacketRouter::remove_stream);
+	ClassDB::bind_method(D_METHOD("get_subscribers", "stream_id"), &OpusPacketRouter::get_subscribers);
+	ClassDB::bind_method(D_METHOD("clear"), &OpusPacketRouter::clear);
+	ClassDB::bind_method(D_METHOD("route_packet", "stream_id", "packet"), &OpusPacketRouter::route_packet);
+	ClassDB::bind_method(D_METHOD("get_outbox_size", "subscriber_id"), &OpusPacketRouter::get_outbox_size);
+	ClassDB::bind_method(D_METHOD("take_packets", "subscriber_id"), &OpusPacketRouter::take_packets);
+	ClassDB::bind_method(D_METHOD("get_stats"), &OpusPacketRouter::get_stats);
+
+	ClassDB::bind_method(D_METHOD("get_max_outbox_packets"), &OpusPacketRouter::get_max_outbox_packets);
+	ClassDB::bind_method(D_METHOD("set_max_outbox_packets", "p_max_outbox_packets"), &OpusPacketRouter::set_max_outbox_packets);
+
+	ClassDB::add_property("OpusPacketRouter", PropertyInfo(Variant::INT, "max_outbox_packets", PROPERTY_HINT_RANGE, "1,1024,1"), "set_max_outbox_packets", "get_max_outbox_packets");
+}
@@ -0,0 +1,63 @@
+#ifndef OPUS_PACKET_ROUTER_H
+#define OPUS_PACKET_ROUTER_H
+
+#include <godot_cpp/classes/ref_counted.hpp>
+#include <godot_cpp/templates/hash_map.hpp>
+#include <godot_cpp/templates/list.hpp>
+#include <godot_cpp/templates/local_vector.hpp>
+
+namespace godot {
+
+// Forwards Opus packets from streams to their subscribers without decoding
+// them, for relay servers. Packets are only checked for a well formed TOC and
+// frame layout. Each subscriber's outbox holds a reference to the same packet
+// buffer (PackedByteArray is copy-on-write), so fanning out doesn't copy data.
+class OpusPacketRouter : public RefCounted {
+	GDCLASS(OpusPacketRouter, RefCounted)
+
+	struct RoutedPacket {
+		int32_t stream_id = 0;
+		PackedByteArray packet;
+	};
+
+	struct Outbox {
+		List<RoutedPacket> packets;
+		uint64_t dropped = 0;
+	};
+
+	HashMap<int32_t, LocalVector<int32_t>> subscriptions;
+	HashMap<int32_t, Outbox> outboxes;
+
+	int max_outbox_packets;
+	uint64_t routed_packets;
+	uint64_t rejected_packets;
+
+protected:
+	static void _bind_methods();
+
+public:
+	OpusPacketRouter();
+
+	static bool validate_packet(const PackedByteArray &packet);
+	static Dictionary get_packet_info(const PackedByteArray &packet, const int sampling_rate);
+
+	void subscribe(const int32_t stream_id, const int32_t subscriber_id);
+	void unsubscribe(const int32_t stream_id, const int32_t subscriber_id);
+	void remove_subscriber(const int32_t subscriber_id);
+	void remove_stream(const int32_t stream_id);
+	PackedInt32Array get_subscribers(const int32_t stream_id) const;
+	void clear();
+
+	int route_packet(const int32_t stream_id, const PackedByteArray &packet);
+
+	int get_outbox_size(const int32_t subscriber_id) const;
+	Array take_packets(const int32_t subscriber_id);
+	Dictionary get_stats() const;
+
+	void set_max_outbox_packets(const int p_max_outbox_packets);
+	int get_max_outbox_packets() const;
+};
+
+} //namespace godot
+
+#endif // OPUS_PACKET_ROUTER_H
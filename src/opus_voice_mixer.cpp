@@ -0,0 +1,383 @@
+#include <string.h>
+
+#include <godot_cpp/classes/time.hpp>
+#include <godot_cpp/classes/worker_thread_pool.hpp>
+#include <godot_cpp/core/class_db.hpp>
+
+#include "audio_kernels.h"
+#include "opus_voice_mixer.h"
+
+using namespace godot;
+
+OpusVoiceMixer::OpusVoiceMixer() {
+	sampling_rate = GodotOpus::SAMPLE_RATE_48000;
+	frame_duration = GodotOpus::FRAMESIZE_20_MS;
+	frame_size = 960;
+	max_queued_packets = 8;
+	parallel_threshold = 8;
+	dropped_packets = 0;
+
+	// Largest packet is 120 ms of audio
+	max_decode_frames = 48000 * 120 / 1000;
+	mix_pcm.resize(frame_size * 2);
+}
+
+OpusVoiceMixer::~OpusVoiceMixer() {
+	_destroy_speakers();
+}
+
+OpusVoiceMixer::Speaker *OpusVoiceMixer::_get_or_add_speaker(const int32_t peer_id) {
+	HashMap<int32_t, Speaker>::Iterator E = speakers.find(peer_id);
+	if (E) {
+		return &E->value;
+	}
+
+	int err;
+	OpusDecoder *decoder = opus_decoder_create((int)sampling_rate, 2, &err);
+	ERR_FAIL_COND_V_MSG(err != OPUS_OK, NULL, opus_strerror(err));
+
+	Speaker speaker;
+	speaker.decoder = decoder;
+	return &speakers.insert(peer_id, speaker)->value;
+}
+
+void OpusVoiceMixer::_queue_packet(const int32_t peer_id, const PackedByteArray &packet) {
+	Speaker *speaker = _get_or_add_speaker(peer_id);
+	ERR_FAIL_NULL(speaker);
+
+	// Cap the queue so a speaker that floods packets can't build up latency
+	while (speaker->packets.size() >= max_queued_packets) {
+		speaker->packets.pop_front();
+		dropped_packets++;
+	}
+	speaker->packets.push_back(packet);
+}
+
+void OpusVoiceMixer::_destroy_speakers() {
+	for (KeyValue<int32_t, Speaker> &E : speakers) {
+		if (E.value.decoder != NULL) {
+			opus_decoder_destroy(E.value.decoder);
+			E.value.decoder = NULL;
+		}
+	}
+	speakers.clear();
+}
+
+void OpusVoiceMixer::_decode_speaker(const int index) {
+	// Bound only for the group task's Callable. active_speakers is empty
+	// outside _mix_frame(), so a call from a script fails here.
+	ERR_FAIL_INDEX_MSG(index, (int)active_speakers.size(), "OpusVoiceMixer _decode_speaker is only called while mixing");
+
+	// Every active speaker decodes into its own buffer
+	Speaker &speaker = *active_speakers[index];
+	if (speaker.pcm.size() < (uint32_t)(max_decode_frames * 2)) {
+		speaker.pcm.resize(max_decode_frames * 2);
+	}
+	float *pcm = speaker.pcm.ptr();
+	const uint64_t start_usec = Time::get_singleton()->get_ticks_usec();
+	if (speaker.current.is_empty()) {
+		speaker.decoded = opus_decode_float(speaker.decoder, NULL, 0, pcm, frame_size, 0);
+	} else {
+		speaker.decoded = opus_decode_float(speaker.decoder, speaker.current.ptr(), speaker.current.size(), pcm, max_decode_frames, 0);
+	}
+	speaker.decode_usec += Time::get_singleton()->get_ticks_usec() - start_usec;
+	speaker.decoded_samples += MAX(0, speaker.decoded);
+	speaker.pcm_pos = 0;
+	speaker.pcm_frames = MAX(0, speaker.decoded);
+}
+
+bool OpusVoiceMixer::_mix_speaker(Speaker &speaker) {
+	// Adds as much of the speaker's decoded audio as still fits in the frame
+	const int frames = MIN(speaker.pcm_frames, frame_size - speaker.filled);
+	if (frames <= 0) {
+		return false;
+	}
+	AudioKernels::mix_gain(speaker.pcm.ptr() + speaker.pcm_pos * 2, mix_pcm.ptr() + speaker.filled * 2, speaker.gain, frames * 2);
+	speaker.pcm_pos += frames;
+	speaker.pcm_frames -= frames;
+	speaker.filled += frames;
+	return true;
+}
+
+bool OpusVoiceMixer::_mix_frame() {
+	// Fills mix_pcm from every speaker, first with what's left of its last
+	// packet, then by decoding its queued packets until the frame is full
+	const int frame_samples = frame_size * 2;
+	memset(mix_pcm.ptr(), 0, sizeof(float) * frame_samples);
+
+	bool mixed = false;
+	for (KeyValue<int32_t, Speaker> &E : speakers) {
+		E.value.filled = 0;
+		mixed = _mix_speaker(E.value) || mixed;
+	}
+
+	// One packet per speaker each round; more rounds only when packets are
+	// shorter than the frame
+	while (true) {
+		active_speakers.clear();
+		for (KeyValue<int32_t, Speaker> &E : speakers) {
+			Speaker &speaker = E.value;
+			if (speaker.filled >= frame_size || speaker.packets.is_empty()) {
+				continue;
+			}
+			speaker.current = speaker.packets.front()->get();
+			speaker.packets.pop_front();
+			active_speakers.push_back(&speaker);
+		}
+
+		const int active = active_speakers.size();
+		if (active == 0) {
+			break;
+		}
+
+		// Decoding dominates, so spread it over the pool once there are enough speakers
+		if (active >= parallel_threshold && active > 1) {
+			WorkerThreadPool *pool = WorkerThreadPool::get_singleton();
+			int64_t task_id = pool->add_group_task(Callable(this, "_decode_speaker"), active, -1, true, "OpusVoiceMixer decode");
+			pool->wait_for_group_task_completion(task_id);
+		} else {
+			for (int i = 0; i < active; i++) {
+				_decode_speaker(i);
+			}
+		}
+
+		// Summed serially in speaker order, so the output doesn't depend on scheduling
+		for (int i = 0; i < active; i++) {
+			Speaker &speaker = *active_speakers[i];
+			speaker.current = PackedByteArray();
+			if (speaker.decoded < 0) {
+				WARN_PRINT(String("OpusVoiceMixer failed to decode packet: ") + opus_strerror(speaker.decoded));
+				continue;
+			}
+			mixed = _mix_speaker(speaker) || mixed;
+		}
+	}
+	return mixed;
+}
+
+bool OpusVoiceMixer::add_speaker(const int32_t peer_id) {
+	return _get_or_add_speaker(peer_id) != NULL;
+}
+
+void OpusVoiceMixer::remove_speaker(const int32_t peer_id) {
+	HashMap<int32_t, Speaker>::Iterator E = speakers.find(peer_id);
+	if (!E) {
+		return;
+	}
+	if (E->value.decoder != NULL) {
+		opus_decoder_destroy(E->value.decoder);
+	}
+	speakers.erase(peer_id);
+}
+
+bool OpusVoiceMixer::has_speaker(const int32_t peer_id) const {
+	return speakers.has(peer_id);
+}
+
+PackedInt32Array OpusVoiceMixer::get_speaker_ids() const {
+	PackedInt32Array ids;
+	for (const KeyValue<int32_t, Speaker> &E : speakers) {
+		ids.push_back(E.key);
+	}
+	return ids;
+}
+
+void OpusVoiceMixer::clear() {
+	_destroy_speakers();
+	dropped_packets = 0;
+}
+
+void OpusVoiceMixer::set_speaker_gain(const int32_t peer_id, const float gain) {
+	Speaker *speaker = _get_or_add_speaker(peer_id);
+	ERR_FAIL_NULL(speaker);
+	speaker->gain = gain;
+}
+
+float OpusVoiceMixer::get_speaker_gain(const int32_t peer_id) const {
+	HashMap<int32_t, Speaker>::ConstIterator E = speakers.find(peer_id);
+	ERR_FAIL_COND_V_MSG(!E, 0.0f, "OpusVoiceMixer has no speaker with that peer id");
+	return E->value.gain;
+}
+
+void OpusVoiceMixer::set_speaker_decoder_complexity(const int32_t peer_id, const int complexity) {
+	ERR_FAIL_COND_MSG(complexity < 0 || complexity > 10, "decoder complexity outside valid range 0-10");
+	Speaker *speaker = _get_or_add_speaker(peer_id);
+	ERR_FAIL_NULL(speaker);
+	speaker->complexity = complexity;
+	opus_decoder_ctl(speaker->decoder, OPUS_SET_COMPLEXITY(complexity));
+}
+
+int OpusVoiceMixer::get_speaker_decoder_complexity(const int32_t peer_id) const {
+	HashMap<int32_t, Speaker>::ConstIterator E = speakers.find(peer_id);
+	ERR_FAIL_COND_V_MSG(!E, 0, "OpusVoiceMixer has no speaker with that peer id");
+	return E->value.complexity;
+}
+
+Dictionary OpusVoiceMixer::get_speaker_stats(const int32_t peer_id) const {
+	HashMap<int32_t, Speaker>::ConstIterator E = speakers.find(peer_id);
+	ERR_FAIL_COND_V_MSG(!E, Dictionary(), "OpusVoiceMixer has no speaker with that peer id");
+	const Speaker &speaker = E->value;
+
+	Dictionary stats;
+	stats["decoder_complexity"] = speaker.complexity;
+	stats["decode_time_usec"] = speaker.decode_usec;
+	stats["decoded_samples"] = speaker.decoded_samples;
+	// Fraction of one core needed to decode this speaker in real time
+	const double audio_usec = (double)speaker.decoded_samples * 1000000.0 / (int)sampling_rate;
+	stats["cpu_load"] = audio_usec > 0.0 ? speaker.decode_usec / audio_usec : 0.0;
+	return stats;
+}
+
+void OpusVoiceMixer::push_packet(const int32_t peer_id, const PackedByteArray &packet) {
+	ERR_FAIL_COND_MSG(packet.is_empty(), "Use push_lost_packet to report a lost packet");
+	_queue_packet(peer_id, packet);
+}
+
+void OpusVoiceMixer::push_lost_packet(const int32_t peer_id) {
+	_queue_packet(peer_id, PackedByteArray());
+}
+
+int OpusVoiceMixer::get_queued_packet_count(const int32_t peer_id) const {
+	HashMap<int32_t, Speaker>::ConstIterator E = speakers.find(peer_id);
+	if (!E) {
+		return 0;
+	}
+	return E->value.packets.size();
+}
+
+bool OpusVoiceMixer::has_queued_packets() const {
+	for (const KeyValue<int32_t, Speaker> &E : speakers) {
+		if (!E.value.packets.is_empty() || E.value.pcm_frames > 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+int OpusVoiceMixer::get_dropped_packet_count() const {
+	return (int)dropped_packets;
+}
+
+PackedVector2Array OpusVoiceMixer::mix() {
+	PackedVector2Array ret;
+	ret.resize(frame_size);
+	if (!_mix_frame()) {
+		// Nobody is talking; resize() leaves the frames zeroed
+		return ret;
+	}
+	AudioKernels::deinterleave_stereo(mix_pcm.ptr(), ret.ptrw(), frame_size);
+	return ret;
+}
+
+int OpusVoiceMixer::mix_to_playback(const Ref<AudioStreamGeneratorPlayback> &playback) {
+	ERR_FAIL_COND_V(playback.is_null(), 0);
+
+	// Mix for as long as there is audio queued and room for it in the playback
+	int frames = 0;
+	PackedVector2Array out;
+	out.resize(frame_size);
+	while (has_queued_packets() && playback->get_frames_available() >= frame_size) {
+		_mix_frame();
+		AudioKernels::deinterleave_stereo(mix_pcm.ptr(), out.ptrw(), frame_size);
+		playback->push_buffer(out);
+		frames += frame_size;
+	}
+	return frames;
+}
+
+int OpusVoiceMixer::get_frame_size() const {
+	return frame_size;
+}
+
+// Getters and Setters ////////////////////////////////////////////////////////
+
+void OpusVoiceMixer::set_sampling_rate(const GodotOpus::SampleRate p_sampling_rate) {
+	int size = GodotOpus::calculate_frame_size((int)p_sampling_rate, frame_duration);
+	ERR_FAIL_COND_MSG(size <= 0, "Invalid sampling rate");
+	sampling_rate = p_sampling_rate;
+	frame_size = size;
+	mix_pcm.resize(frame_size * 2);
+	max_decode_frames = (int)sampling_rate * 120 / 1000;
+
+	// Decoder state size doesn't depend on the rate, so reinitialize in place
+	for (KeyValue<int32_t, Speaker> &E : speakers) {
+		opus_decoder_init(E.value.decoder, (int)sampling_rate, 2);
+		opus_decoder_ctl(E.value.decoder, OPUS_SET_COMPLEXITY(E.value.complexity));
+		E.value.packets.clear();
+		E.value.pcm_frames = 0;
+		E.value.decode_usec = 0;
+		E.value.decoded_samples = 0;
+	}
+}
+
+GodotOpus::SampleRate OpusVoiceMixer::get_sampling_rate() const {
+	return sampling_rate;
+}
+
+void OpusVoiceMixer::set_frame_duration(const GodotOpus::FrameSizeDuration p_frame_duration) {
+	int size = GodotOpus::calculate_frame_size((int)sampling_rate, p_frame_duration);
+	ERR_FAIL_COND_MSG(size <= 0, "Invalid frame duration");
+	frame_duration = p_frame_duration;
+	frame_size = size;
+	mix_pcm.resize(frame_size * 2);
+}
+
+GodotOpus::FrameSizeDuration OpusVoiceMixer::get_frame_duration() const {
+	return frame_duration;
+}
+
+void OpusVoiceMixer::set_max_queued_packets(const int p_max_queued_packets) {
+	ERR_FAIL_COND_MSG(p_max_queued_packets < 1, "max_queued_packets must be at least 1");
+	max_queued_packets = p_max_queued_packets;
+}
+
+int OpusVoiceMixer::get_max_queued_packets() const {
+	return max_queued_packets;
+}
+
+void OpusVoiceMixer::set_parallel_threshold(const int p_parallel_threshold) {
+	ERR_FAIL_COND_MSG(p_parallel_threshold < 1, "parallel_threshold must be at least 1");
+	parallel_threshold = p_parallel_threshold;
+}
+
+int OpusVoiceMixer::get_parallel_threshold() const {
+	return parallel_threshold;
+}
+
+// Bind methods
+
+void OpusVoiceMixer::_bind_methods() {
+	ClassDB::bind_method(D_METHOD("_decode_speaker", "index"), &OpusVoiceMixer::_decode_speaker);
+	ClassDB::bind_method(D_METHOD("add_speaker", "peer_id"), &OpusVoiceMixer::add_speaker);
+	ClassDB::bind_method(D_METHOD("remove_speaker", "peer_id"), &OpusVoiceMixer::remove_speaker);
+	ClassDB::bind_method(D_METHOD("has_speaker", "peer_id"), &OpusVoiceMixer::has_speaker);
+	ClassDB::bind_method(D_METHOD("get_speaker_ids"), &OpusVoiceMixer::get_speaker_ids);
+	ClassDB::bind_method(D_METHOD("clear"), &OpusVoiceMixer::clear);
+	ClassDB::bind_method(D_METHOD("set_speaker_gain", "peer_id", "gain"), &OpusVoiceMixer::set_speaker_gain);
+	ClassDB::bind_method(D_METHOD("get_speaker_gain", "peer_id"), &OpusVoiceMixer::get_speaker_gain);
+	ClassDB::bind_method(D_METHOD("set_speaker_decoder_complexity", "peer_id", "complexity"), &OpusVoiceMixer::set_speaker_decoder_complexity);
+	ClassDB::bind_method(D_METHOD("get_speaker_decoder_complexity", "peer_id"), &OpusVoiceMixer::get_speaker_decoder_complexity);
+	ClassDB::bind_method(D_METHOD("get_speaker_stats", "peer_id"), &OpusVoiceMixer::get_speaker_stats);
+	ClassDB::bind_method(D_METHOD("push_packet", "peer_id", "packet"), &OpusVoiceMixer::push_packet);
+	ClassDB::bind_method(D_METHOD("push_lost_packet", "peer_id"), &OpusVoiceMixer::push_lost_packet);
+	ClassDB::bind_method(D_METHOD("get_queued_packet_count", "peer_id"), &OpusVoiceMixer::get_queued_packet_count);
+	ClassDB::bind_method(D_METHOD("has_queued_packets"), &OpusVoiceMixer::has_queued_packets);
+	ClassDB::bind_method(D_METHOD("get_dropped_packet_count"), &OpusVoiceMixer::get_dropped_packet_count);
+	ClassDB::bind_method(D_METHOD("mix"), &OpusVoiceMixer::mix);
+	ClassDB::bind_method(D_METHOD("mix_to_playback", "playback"), &OpusVoiceMixer::mix_to_playback);
+	ClassDB::bind_method(D_METHOD("get_frame_size"), &OpusVoiceMixer::get_frame_size);
+
+	ClassDB::bind_method(D_METHOD("get_sampling_rate"), &OpusVoiceMixer::get_sampling_rate);
+	ClassDB::bind_method(D_METHOD("set_sampling_rate", "p_sampling_rate"), &OpusVoiceMixer::set_sampling_rate);
+	ClassDB::bind_method(D_METHOD("get_frame_duration"), &OpusVoiceMixer::get_frame_duration);
+	ClassDB::bind_method(D_METHOD("set_frame_duration", "p_frame_duration"), &OpusVoiceMixer::set_frame_duration);
+	ClassDB::bind_method(D_METHOD("get_max_queued_packets"), &OpusVoiceMixer::get_max_queued_packets);
+	ClassDB::bind_method(D_METHOD("set_max_queued_packets", "p_max_queued_packets"), &OpusVoiceMixer::set_max_queued_packets);
+	ClassDB::bind_method(D_METHOD("get_parallel_threshold"), &OpusVoiceMixer::get_parallel_threshold);
+	ClassDB::bind_method(D_METHOD("set_parallel_threshold", "p_parallel_threshold"), &OpusVoiceMixer::set_parallel_threshold);
+
+	ClassDB::add_property("OpusVoiceMixer", PropertyInfo(Variant::INT, "sampling_rate", PROPERTY_HINT_ENUM, "8 kHz:8000,12 kHz:12000,16 kHz:16000,24 kHz:24000,48 kHz:48000"), "set_sampling_rate", "get_sampling_rate");
+	ClassDB::add_property("OpusVoiceMixer", PropertyInfo(Variant::INT, "frame_duration", PROPERTY_HINT_ENUM, "2.5 ms:5001,5 ms:5002,10 ms:5003,20 ms:5004,40 ms:5005,60 ms:5006,80 ms:5007,100 ms:5008,120 ms:5009"), "set_frame_duration", "get_frame_duration");
+	ClassDB::add_property("OpusVoiceMixer", PropertyInfo(Variant::INT, "max_queued_packets", PROPERTY_HINT_RANGE, "1,64,1"), "set_max_queued_packets", "get_max_queued_packets");
+	ClassDB::add_property("OpusVoiceMixer", PropertyInfo(Variant::INT, "parallel_threshold", PROPERTY_HINT_RANGE, "1,256,1"), "set_parallel_threshold", "get_parallel_threshold");
+}
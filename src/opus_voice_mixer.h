@@ -0,0 +1,116 @@
+#ifndef OPUS_VOICE_MIXER_H
+#define OPUS_VOICE_MIXER_H
+
+#include <opus.h>
+#include <godot_cpp/classes/audio_stream_generator_playback.hpp>
+#include <godot_cpp/classes/ref_counted.hpp>
+#include <godot_cpp/templates/hash_map.hpp>
+#include <godot_cpp/templates/list.hpp>
+#include <godot_cpp/templates/local_vector.hpp>
+
+#include "godot_opus.h"
+
+namespace godot {
+
+// Decodes and mixes the voices of many remote speakers into a single stereo
+// output, so one AudioStreamPlayer can play all of them. Each speaker, keyed
+// by peer id, gets its own decoder state and gain. Every mix() takes one frame
+// of audio from each speaker, decoding as many queued packets as that needs;
+// speakers with nothing queued are left out.
+class OpusVoiceMixer : public RefCounted {
+	GDCLASS(OpusVoiceMixer, RefCounted)
+
+	struct Speaker {
+		OpusDecoder *decoder = NULL;
+		float gain = 1.0f;
+		int complexity = 0;
+		// An empty packet marks a lost packet, to be concealed
+		List<PackedByteArray> packets;
+
+		// Packet being decoded this frame, and the decode result
+		PackedByteArray current;
+		int decoded = 0;
+
+		// Decoded stereo audio, from pcm_pos on not mixed yet. What a packet
+		// longer than the mixer's frame leaves over goes into the next frame.
+		LocalVector<float> pcm;
+		int pcm_pos = 0;
+		int pcm_frames = 0;
+		// Frames of the current mix filled so far
+		int filled = 0;
+
+		// Time spent decoding, and the samples produced
+		uint64_t decode_usec = 0;
+		int64_t decoded_samples = 0;
+	};
+
+	HashMap<int32_t, Speaker> speakers;
+
+	GodotOpus::SampleRate sampling_rate;
+	GodotOpus::FrameSizeDuration frame_duration;
+	int frame_size;
+	int max_queued_packets;
+	int parallel_threshold;
+	uint64_t dropped_packets;
+
+	// Decoders always output stereo; mono packets are upmixed by libopus
+	int max_decode_frames;
+	LocalVector<Speaker *> active_speakers;
+	LocalVector<float> mix_pcm;
+
+	Speaker *_get_or_add_speaker(const int32_t peer_id);
+	void _queue_packet(const int32_t peer_id, const PackedByteArray &packet);
+	void _destroy_speakers();
+	bool _mix_speaker(Speaker &speaker);
+	bool _mix_frame();
+
+protected:
+	static void _bind_methods();
+
+	void _decode_speaker(const int index);
+
+public:
+	OpusVoiceMixer();
+	~OpusVoiceMixer();
+
+	bool add_speaker(const int32_t peer_id);
+	void remove_speaker(const int32_t peer_id);
+	bool has_speaker(const int32_t peer_id) const;
+	PackedInt32Array get_speaker_ids() const;
+	void clear();
+
+	void set_speaker_gain(const int32_t peer_id, const float gain);
+	float get_speaker_gain(const int32_t peer_id) const;
+
+	// Higher complexities enable deep PLC (5+) and OSCE enhancement (6+), at a CPU cost
+	void set_speaker_decoder_complexity(const int32_t peer_id, const int complexity);
+	int get_speaker_decoder_complexity(const int32_t peer_id) const;
+	Dictionary get_speaker_stats(const int32_t peer_id) const;
+
+	void push_packet(const int32_t peer_id, const PackedByteArray &packet);
+	void push_lost_packet(const int32_t peer_id);
+	int get_queued_packet_count(const int32_t peer_id) const;
+	bool has_queued_packets() const;
+	int get_dropped_packet_count() const;
+
+	PackedVector2Array mix();
+	int mix_to_playback(const Ref<AudioStreamGeneratorPlayback> &playback);
+
+	int get_frame_size() const;
+
+	void set_sampling_rate(const GodotOpus::SampleRate p_sampling_rate);
+	GodotOpus::SampleRate get_sampling_rate() const;
+
+	void set_frame_duration(const GodotOpus::FrameSizeDuration p_frame_duration);
+	GodotOpus::FrameSizeDuration get_frame_duration() const;
+
+	void set_max_queued_packets(const int p_max_queued_packets);
+	int get_max_queued_packets() const;
+
+	void set_parallel_threshold(const int p_parallel_threshold);
+	int get_parallel_threshold() const;
+};
+
+} //namespace godot
+
+#endif // OPUS_VOICE_MIXER_H
@@ -0,0 +1,111 @@
+#ifndef PACKET_QUEUE_H
+#define PACKET_QUEUE_H
+
+#include <godot_cpp/variant/packed_byte_array.hpp>
+
+#include "spsc_ring_buffer.h"
+
+namespace godot {
+
+// Lock-free single-producer/single-consumer queue of variable sized packets,
+// stored back to back in a byte ring as a 2 byte length followed by the payload.
+// Pushing and popping don't allocate, so either end may be the audio thread.
+class PacketQueue {
+	SpscRingBuffer<uint8_t> buffer;
+
+public:
+	static constexpr int MAX_PACKET_SIZE = 0xFFFF;
+
+	// Producer side. The header and payload are committed together, so the
+	// consumer never sees half a packet. Returns false if the queue is full.
+	bool push(const uint8_t *p_data, int p_length) {
+		ERR_FAIL_COND_V(p_length < 0 || p_length > MAX_PACKET_SIZE, false);
+
+		uint8_t *first, *second;
+		int first_size, second_size;
+		const int total = p_length + 2;
+		if (buffer.write_spans(total, first, first_size, second, second_size) != total) {
+			return false;
+		}
+
+		const uint8_t header[2] = { (uint8_t)(p_length & 0xFF), (uint8_t)(p_length >> 8) };
+		for (int i = 0; i < total; i++) {
+			uint8_t byte = i < 2 ? header[i] : p_data[i - 2];
+			if (i < first_size) {
+				first[i] = byte;
+			} else {
+				second[i - first_size] = byte;
+			}
+		}
+		buffer.advance_write(total);
+		return true;
+	}
+
+	// Largest packet that can be pushed right now.
+	inline int space_left() const {
+		return MAX(buffer.space_left() - 2, 0);
+	}
+
+	// Consumer side.
+	inline bool is_empty() const {
+		return buffer.data_left() < 2;
+	}
+
+	// Size of the next packet, or -1 if the queue is empty.
+	int peek_size() {
+		if (is_empty()) {
+			return -1;
+		}
+		uint8_t header[2];
+		buffer.read(header, 2, false);
+		return header[0] | (header[1] << 8);
+	}
+
+	// Pops the next packet into p_dst, which must hold peek_size() bytes.
+	// Returns the packet size, or -1 if the queue is empty or p_dst is too small.
+	int pop(uint8_t *p_dst, int p_max_size) {
+		int length = peek_size();
+		if (length < 0 || length > p_max_size) {
+			return -1;
+		}
+		buffer.advance_read(2);
+		buffer.read(p_dst, length);
+		return length;
+	}
+
+	// Copies the next packet into p_dst without removing it. p_dst receives the
+	// 2 byte header first, so it must hold peek_size() + 2 bytes; the payload
+	// starts at p_dst + 2. Returns the packet size, or -1 as pop() does.
+	int peek(uint8_t *p_dst, int p_max_size) {
+		int length = peek_size();
+		if (length < 0 || length + 2 > p_max_size) {
+			return -1;
+		}
+		buffer.read(p_dst, length + 2, false);
+		return length;
+	}
+
+	PackedByteArray pop() {
+		PackedByteArray ret;
+		int length = peek_size();
+		if (length >= 0) {
+			ret.resize(length);
+			pop(ret.ptrw(), length);
+		}
+		return ret;
+	}
+
+	void clear() {
+		// Consumer side; safe while the producer keeps pushing
+		buffer.advance_read(buffer.data_left());
+	}
+
+	// Not thread-safe; discards any queued packets.
+	void resize(int p_bytes) {
+		buffer.resize(nearest_shift(p_bytes));
+	}
+};
+
+} //namespace godot
+
+#endif // PACKET_QUEUE_H
@@ -1,7 +1,17 @@
 
 #include "register_types.h"
 
+#include "audio_effect_opus_capture.h"
+#include "audio_stream_opus.h"
 #include "godot_opus.h"
+#include "opus_ambisonics.h"
+#include "opus_batch_decoder.h"
+#include "opus_decoder_state.h"
+#include "opus_encoder_state.h"
+#include "opus_jitter_buffer.h"
+#include "opus_multistream.h"
+#include "opus_packet_router.h"
+#include "opus_voice_mixer.h"
 
 #include <gdextension_interface.h>
 #include <godot_cpp/core/defs.hpp>
@@ -14,7 +24,19 @@ void initialize_opus_module(ModuleInitializationLevel p_level) {
 		return;
 	}
 
+	ClassDB::register_class<OpusEncoderState>();
+	ClassDB::register_class<OpusDecoderState>();
 	ClassDB::register_class<GodotOpus>();
+	ClassDB::register_class<AudioEffectOpusCapture>();
+	ClassDB::register_class<AudioEffectOpusCaptureInstance>();
+	ClassDB::register_class<AudioStreamOpus>();
+	ClassDB::register_class<AudioStreamPlaybackOpus>();
+	ClassDB::register_class<OpusJitterBuffer>();
+	ClassDB::register_class<OpusVoiceMixer>();
+	ClassDB::register_class<OpusBatchDecoder>();
+	ClassDB::register_class<OpusPacketRouter>();
+	ClassDB::register_class<OpusMultistream>();
+	ClassDB::register_class<OpusAmbisonics>();
 }
 
 void uninitialize_opus_module(ModuleInitializationLevel p_level) {
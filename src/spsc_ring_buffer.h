@@ -0,0 +1,155 @@
+#ifndef SPSC_RING_BUFFER_H
+#define SPSC_RING_BUFFER_H
+
+#include <godot_cpp/core/error_macros.hpp>
+#include <godot_cpp/core/math.hpp>
+#include <godot_cpp/templates/local_vector.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace godot {
+
+// Lock-free single-producer/single-consumer ring buffer with a power of two
+// size. One thread may write (write, write_spans, advance_write) while another
+// reads (read, read_ptr, advance_read) without any locking. The indices only ever increase and are masked on access, so the whole
+// buffer is usable (no empty slot). resize() and clear() are not thread-safe.
+template <typename T>
+class SpscRingBuffer {
+	static_assert(std::is_trivially_copyable<T>::value, "SpscRingBuffer requires a trivially copyable type");
+
+	static constexpr size_t CACHE_LINE_SIZE = 64;
+
+	// Producer and consumer indices live on separate cache lines so the two
+	// threads don't false-share; the producer caches its view of read_pos.
+	alignas(CACHE_LINE_SIZE) std::atomic<uint32_t> write_pos{ 0 };
+	uint32_t cached_read_pos = 0;
+
+	alignas(CACHE_LINE_SIZE) std::atomic<uint32_t> read_pos{ 0 };
+
+	alignas(CACHE_LINE_SIZE) LocalVector<T> data;
+	uint32_t size_mask = 0;
+
+public:
+	// Consumer side ///////////////////////////////////////////////////////////
+
+	inline int data_left() const {
+		return (int)(write_pos.load(std::memory_order_acquire) - read_pos.load(std::memory_order_relaxed));
+	}
+
+	int read(T *p_buf, int p_size, bool p_advance = true) {
+		const uint32_t rp = read_pos.load(std::memory_order_relaxed);
+		const int left = (int)(write_pos.load(std::memory_order_acquire) - rp);
+		p_size = MIN(left, p_size);
+		if (p_size <= 0) {
+			return 0;
+		}
+
+		const uint32_t pos = rp & size_mask;
+		const int first = MIN(p_size, size() - (int)pos);
+		memcpy(p_buf, data.ptr() + pos, sizeof(T) * first);
+		memcpy(p_buf + first, data.ptr(), sizeof(T) * (p_size - first));
+
+		if (p_advance) {
+			read_pos.store(rp + p_size, std::memory_order_release);
+		}
+		return p_size;
+	}
+
+	// Pointer to p_size readable elements at the read position, or nullptr if
+	// fewer are available or they wrap around the end of the buffer.
+	inline const T *read_ptr(int p_size) const {
+		const uint32_t rp = read_pos.load(std::memory_order_relaxed);
+		const uint32_t pos = rp & size_mask;
+		const int left = (int)(write_pos.load(std::memory_order_acquire) - rp);
+		if (p_size > left || (int)pos + p_size > size()) {
+			return nullptr;
+		}
+		return data.ptr() + pos;
+	}
+
+	inline int advance_read(int p_n) {
+		const uint32_t rp = read_pos.load(std::memory_order_relaxed);
+		const int left = (int)(write_pos.load(std::memory_order_acquire) - rp);
+		p_n = MIN(p_n, left);
+		read_pos.store(rp + p_n, std::memory_order_release);
+		return p_n;
+	}
+
+	// Producer side ///////////////////////////////////////////////////////////
+
+	inline int space_left() const {
+		return size() - (int)(write_pos.load(std::memory_order_relaxed) - read_pos.load(std::memory_order_acquire));
+	}
+
+	int write(const T *p_buf, int p_size) {
+		T *first, *second;
+		int first_size, second_size;
+		p_size = write_spans(p_size, first, first_size, second, second_size);
+		memcpy(first, p_buf, sizeof(T) * first_size);
+		memcpy(second, p_buf + first_size, sizeof(T) * second_size);
+		advance_write(p_size);
+		return p_size;
+	}
+
+	bool write(const T &p_v) {
+		return write(&p_v, 1) == 1;
+	}
+
+	// Up to two contiguous writable spans at the write position, covering
+	// min(p_size, space_left()) elements; r_second is only used if the space
+	// wraps around the end of the buffer. Commit with advance_write().
+	int write_spans(int p_size, T *&r_first, int &r_first_size, T *&r_second, int &r_second_size) {
+		const uint32_t wp = write_pos.load(std::memory_order_relaxed);
+		if ((int)(wp - cached_read_pos) + p_size > size()) {
+			// Only touch the consumer's cache line when the cached view is too stale
+			cached_read_pos = read_pos.load(std::memory_order_acquire);
+		}
+		p_size = CLAMP(size() - (int)(wp - cached_read_pos), 0, p_size);
+
+		const uint32_t pos = wp & size_mask;
+		r_first = data.ptr() + pos;
+		r_first_size = MIN(p_size, size() - (int)pos);
+		r_second = data.ptr();
+		r_second_size = p_size - r_first_size;
+		return p_size;
+	}
+
+	inline int advance_write(int p_n) {
+		const uint32_t wp = write_pos.load(std::memory_order_relaxed);
+		const int left = size() - (int)(wp - read_pos.load(std::memory_order_acquire));
+		p_n = MIN(p_n, left);
+		write_pos.store(wp + p_n, std::memory_order_release);
+		return p_n;
+	}
+
+	// Not thread-safe /////////////////////////////////////////////////////////
+
+	inline int size() const {
+		return (int)data.size();
+	}
+
+	inline void clear() {
+		read_pos.store(0, std::memory_order_relaxed);
+		write_pos.store(0, std::memory_order_relaxed);
+		cached_read_pos = 0;
+	}
+
+	// Discards any buffered data.
+	void resize(int p_power) {
+		ERR_FAIL_COND(p_power < 0 || p_power > 30);
+		data.resize(1u << p_power);
+		size_mask = (1u << p_power) - 1;
+		clear();
+	}
+
+	SpscRingBuffer(int p_power = 0) {
+		resize(p_power);
+	}
+};
+
+} //namespace godot
+
+#endif // SPSC_RING_BUFFER_H
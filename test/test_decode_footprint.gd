@@ -0,0 +1,59 @@
+# Checks that concealing a gap much longer than a packet neither cuts it short
+# nor grows the decode buffers, at every Opus rate, mono and stereo. Memory is
+# read from the engine's static allocation count, which only debug builds
+# (such as the editor) keep. Run headless from the repository root:
+#   godot --headless --path bin -s "$PWD/test/test_decode_footprint.gd"
+extends SceneTree
+
+const RATES = [
+	GodotOpus.SAMPLE_RATE_8000,
+	GodotOpus.SAMPLE_RATE_12000,
+	GodotOpus.SAMPLE_RATE_16000,
+	GodotOpus.SAMPLE_RATE_24000,
+	GodotOpus.SAMPLE_RATE_48000,
+]
+const CHANNELS = [GodotOpus.CHANNELS_MONO, GodotOpus.CHANNELS_STEREO]
+const GAP_SECONDS = 2
+# Room for allocations outside the decoder. Growing the scratch for the gap
+# would take at least 2 s of samples (64 KB at 8 kHz mono).
+const SLACK_BYTES = 4096
+
+
+func _init() -> void:
+	if OS.get_static_memory_usage() == 0:
+		printerr("Needs a debug build of Godot, which counts static memory")
+		quit(1)
+		return
+
+	var failed := 0
+	for rate in RATES:
+		for channels in CHANNELS:
+			var decoder := OpusDecoderState.new()
+			decoder.sampling_rate = rate
+			decoder.channels = channels
+			if not decoder.initialize():
+				printerr("Failed to initialize decoder at %d Hz, %d channels" % [rate, channels])
+				failed += 1
+				continue
+
+			# Baseline with the decoder holding a one frame result, as after any decode
+			decoder.decode_dropped(decoder.get_frame_size())
+			var before := OS.get_static_memory_usage()
+
+			var gap: int = rate * GAP_SECONDS
+			var frames := decoder.decode_dropped(gap).size()
+			if frames != gap:
+				printerr("%d Hz, %d channels: %d frame gap returned %d frames" % [rate, channels, gap, frames])
+				failed += 1
+
+			# The decoder keeps its last result, so drop the long one the same way
+			decoder.decode_dropped(decoder.get_frame_size())
+			var after := OS.get_static_memory_usage()
+			if after - before > SLACK_BYTES:
+				printerr("%d Hz, %d channels: a %d s gap grew the decoder by %d bytes" % [rate, channels, GAP_SECONDS, after - before])
+				failed += 1
+			else:
+				print("%d Hz, %d channels: %d bytes after a %d s gap" % [rate, channels, after - before, GAP_SECONDS])
+			decoder.release()
+
+	quit(1 if failed > 0 else 0)